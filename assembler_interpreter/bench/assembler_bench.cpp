@@ -0,0 +1,565 @@
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "assembler_interpreter/bench/counting_allocator.h"
+#include "assembler_interpreter/src/assembler_main.h"
+#include "assembler_interpreter/src/lockstep.h"
+#include "assembler_interpreter/src/machine.h"
+#include "assembler_interpreter/src/program_cache.h"
+#include "assembler_interpreter/src/program_image.h"
+
+namespace
+{
+enum class Workload : int
+{
+    Factorial,
+    Fibonacci,
+    Gcd,
+    Power,
+    StraightLine,
+    Loop,
+    Recursion,
+    Messages,
+    KnownValues
+};
+
+const std::string factorial_program{R"(
+mov   a, 5
+mov   b, a
+mov   c, a
+call  proc_fact
+call  print
+end
+
+proc_fact:
+    dec   b
+    mul   c, b
+    cmp   b, 1
+    jne   proc_fact
+    ret
+
+print:
+    msg   a, '! = ', c ; output text
+    ret
+)"};
+
+const std::string fibonacci_program{R"(
+mov   a, 8            ; value
+mov   b, 0            ; next
+mov   c, 0            ; counter
+mov   d, 0            ; first
+mov   e, 1            ; second
+call  proc_fib
+call  print
+end
+
+proc_fib:
+    cmp   c, 2
+    jl    func_0
+    mov   b, d
+    add   b, e
+    mov   d, e
+    mov   e, b
+    inc   c
+    cmp   c, a
+    jle   proc_fib
+    ret
+
+func_0:
+    mov   b, c
+    inc   c
+    jmp   proc_fib
+
+print:
+    msg   'Term ', a, ' of Fibonacci series is: ', b        ; output text
+    ret)"};
+
+const std::string gcd_program{R"(
+mov   a, 81         ; value1
+mov   b, 153        ; value2
+call  init
+call  proc_gcd
+call  print
+end
+
+proc_gcd:
+    cmp   c, d
+    jne   loop
+    ret
+
+loop:
+    cmp   c, d
+    jg    a_bigger
+    jmp   b_bigger
+
+a_bigger:
+    sub   c, d
+    jmp   proc_gcd
+
+b_bigger:
+    sub   d, c
+    jmp   proc_gcd
+
+init:
+    cmp   a, 0
+    jl    a_abs
+    cmp   b, 0
+    jl    b_abs
+    mov   c, a            ; temp1
+    mov   d, b            ; temp2
+    ret
+
+a_abs:
+    mul   a, -1
+    jmp   init
+
+b_abs:
+    mul   b, -1
+    jmp   init
+
+print:
+    msg   'gcd(', a, ', ', b, ') = ', c
+    ret)"};
+
+const std::string power_program{R"(
+mov   a, 2            ; value1
+mov   b, 10           ; value2
+mov   c, a            ; temp1
+mov   d, b            ; temp2
+call  proc_func
+call  print
+end
+
+proc_func:
+    cmp   d, 1
+    je    continue
+    mul   c, a
+    dec   d
+    call  proc_func
+
+continue:
+    ret
+
+print:
+    msg a, '^', b, ' = ', c
+    ret)"};
+
+std::string straight_line_program(std::int64_t length)
+{
+    static const char* const lines[]{"mov a, 7", "add b, a", "mul b, 3", "sub c, b", "div b, 2", "inc c", "dec a"};
+    std::ostringstream program{};
+    for (std::int64_t line{0}; line < length; ++line)
+    {
+        program << lines[line % 7] << '\n';
+    }
+    program << "end\n";
+    return program.str();
+}
+
+std::string loop_program(std::int64_t iterations)
+{
+    std::ostringstream program{};
+    program << "mov a, " << iterations << "\n"
+            << "mov c, 0\n"
+            << "outer:\n"
+            << "    mov b, 10\n"
+            << "inner:\n"
+            << "    add c, b\n"
+            << "    dec b\n"
+            << "    cmp b, 0\n"
+            << "    jg inner\n"
+            << "    dec a\n"
+            << "    cmp a, 0\n"
+            << "    jne outer\n"
+            << "msg 'c = ', c\n"
+            << "end\n";
+    return program.str();
+}
+
+std::string recursion_program(std::int64_t depth)
+{
+    std::ostringstream program{};
+    program << "mov a, " << depth << "\n"
+            << "mov b, 0\n"
+            << "call recurse\n"
+            << "msg 'b = ', b\n"
+            << "end\n"
+            << "recurse:\n"
+            << "    dec a\n"
+            << "    cmp a, 0\n"
+            << "    je base\n"
+            << "    call recurse\n"
+            << "base:\n"
+            << "    inc b\n"
+            << "    ret\n";
+    return program.str();
+}
+
+std::string message_program(std::int64_t count)
+{
+    std::ostringstream program{};
+    program << "mov a, " << count << "\n"
+            << "print:\n"
+            << "    msg 'value ', a, ' squared ', b, '; '\n"
+            << "    mov b, a\n"
+            << "    mul b, a\n"
+            << "    dec a\n"
+            << "    cmp a, 0\n"
+            << "    jne print\n"
+            << "end\n";
+    return program.str();
+}
+
+// Loop whose body computes and checks values that are the same in every iteration.
+std::string known_values_program(std::int64_t iterations)
+{
+    std::ostringstream program{};
+    program << "mov c, " << iterations << "\n"
+            << "mov d, 0\n"
+            << "loop:\n"
+            << "    mov a, 5\n"
+            << "    add a, 3\n"
+            << "    mul a, 2\n"
+            << "    cmp a, 16\n"
+            << "    jne wrong\n"
+            << "    mov b, a\n"
+            << "    sub b, 6\n"
+            << "    add d, b\n"
+            << "    dec c\n"
+            << "    cmp c, 0\n"
+            << "    jg loop\n"
+            << "msg 'd = ', d\n"
+            << "end\n"
+            << "wrong:\n"
+            << "    msg 'a = ', a\n"
+            << "    end\n";
+    return program.str();
+}
+
+std::string make_program(benchmark::State const& state)
+{
+    const auto size{state.range(1)};
+    switch (static_cast<Workload>(state.range(0)))
+    {
+        case Workload::Factorial:
+            return factorial_program;
+        case Workload::Fibonacci:
+            return fibonacci_program;
+        case Workload::Gcd:
+            return gcd_program;
+        case Workload::Power:
+            return power_program;
+        case Workload::StraightLine:
+            return straight_line_program(size);
+        case Workload::Loop:
+            return loop_program(size);
+        case Workload::Recursion:
+            return recursion_program(size);
+        case Workload::Messages:
+            return message_program(size);
+        case Workload::KnownValues:
+            return known_values_program(size);
+    }
+    return {};
+}
+
+// Instructions are counted as the source instructions the reference engine executes, so engines that
+// fuse or drop instructions are compared on the same amount of work.
+std::uint64_t executed_instructions(std::string const& program)
+{
+    Machine machine{};
+    machine.set_engine(ExecutionEngine::Reference);
+    machine.load_program(program);
+    machine.run_program();
+    return machine.executed_instructions();
+}
+
+std::size_t loaded_instructions(std::string const& program)
+{
+    Machine machine{};
+    machine.parse_program(program);
+    return machine.program_size();
+}
+
+void set_instruction_counters(benchmark::State& state, std::uint64_t instructions_per_iteration)
+{
+    const auto instructions{static_cast<double>(instructions_per_iteration) * state.iterations()};
+    state.counters["instructions/s"] = benchmark::Counter(instructions, benchmark::Counter::kIsRate);
+    state.counters["time/instruction"] =
+        benchmark::Counter(instructions, benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+}
+
+void BM_ParseProgram(benchmark::State& state)
+{
+    const auto program{make_program(state)};
+    const auto allocations_before{allocation_count.load()};
+    for (auto _ : state)
+    {
+        Machine machine{};
+        machine.parse_program(program);
+        benchmark::DoNotOptimize(&machine);
+    }
+    state.counters["allocations/load"] = benchmark::Counter(
+        static_cast<double>(allocation_count.load() - allocations_before), benchmark::Counter::kAvgIterations);
+    set_instruction_counters(state, loaded_instructions(program));
+}
+
+// Loading from a program image instead of the source, the cold start of a worker sharing a program library.
+void BM_DecodeProgramImage(benchmark::State& state)
+{
+    Machine compiler{};
+    compiler.load_program(make_program(state));
+    const auto image{encode_program_image(*compiler.compiled_program())};
+    for (auto _ : state)
+    {
+        Machine machine{};
+        machine.load_program(decode_program_image(image));
+        benchmark::DoNotOptimize(&machine);
+    }
+    set_instruction_counters(state, loaded_instructions(make_program(state)));
+}
+
+void BM_PreRun(benchmark::State& state)
+{
+    const auto program{make_program(state)};
+    for (auto _ : state)
+    {
+        state.PauseTiming();
+        Machine machine{};
+        machine.parse_program(program);
+        state.ResumeTiming();
+        machine.pre_run();
+        benchmark::DoNotOptimize(&machine);
+    }
+    set_instruction_counters(state, loaded_instructions(program));
+}
+
+void BM_RunProgram(benchmark::State& state)
+{
+    const auto program{make_program(state)};
+    const auto engine{static_cast<ExecutionEngine>(state.range(2))};
+    for (auto _ : state)
+    {
+        state.PauseTiming();
+        Machine machine{};
+        machine.set_engine(engine);
+        machine.load_program(program);
+        state.ResumeTiming();
+        machine.run_program();
+        benchmark::DoNotOptimize(&machine);
+    }
+    set_instruction_counters(state, executed_instructions(program));
+}
+
+// Machines with 64-bit registers, compare with BM_RunProgram on the same engine.
+void BM_RunWide(benchmark::State& state)
+{
+    const auto program{make_program(state)};
+    const auto engine{static_cast<ExecutionEngine>(state.range(2))};
+    for (auto _ : state)
+    {
+        state.PauseTiming();
+        Machine64 machine{};
+        machine.set_engine(engine);
+        machine.load_program(program);
+        state.ResumeTiming();
+        machine.run_program();
+        benchmark::DoNotOptimize(&machine);
+    }
+    set_instruction_counters(state, executed_instructions(program));
+}
+
+// One run over every lane, counting the instructions of all lanes. Every lane starts from the same registers, so
+// none branch apart, compare time/instruction with BM_RunProgram.
+void BM_RunLockstep(benchmark::State& state)
+{
+    const auto program{make_program(state)};
+    const auto lanes{static_cast<std::size_t>(state.range(2))};
+    LockstepMachine lockstep{lanes};
+    lockstep.load_program(program);
+    for (auto _ : state)
+    {
+        lockstep.run_program();
+        benchmark::DoNotOptimize(&lockstep);
+    }
+    set_instruction_counters(state, executed_instructions(program) * lanes);
+}
+
+// Bytecode engine recording every op into a trace ring, compare with BM_RunProgram on engine 1.
+void BM_RunTraced(benchmark::State& state)
+{
+    const auto program{make_program(state)};
+    TraceBuffer trace{1 << 16};
+    for (auto _ : state)
+    {
+        state.PauseTiming();
+        Machine machine{};
+        machine.set_trace_buffer(&trace);
+        machine.load_program(program);
+        state.ResumeTiming();
+        machine.run_program();
+        benchmark::DoNotOptimize(&machine);
+    }
+    set_instruction_counters(state, executed_instructions(program));
+}
+
+// Bytecode engine under limits none of the workloads reaches, compare with BM_RunProgram on engine 1.
+void BM_RunLimited(benchmark::State& state)
+{
+    const auto program{make_program(state)};
+    for (auto _ : state)
+    {
+        state.PauseTiming();
+        Machine machine{};
+        machine.set_execution_limits({std::uint64_t{1} << 40, 1 << 20, std::chrono::seconds{60}});
+        machine.load_program(program);
+        state.ResumeTiming();
+        machine.run_program();
+        benchmark::DoNotOptimize(&machine);
+    }
+    set_instruction_counters(state, executed_instructions(program));
+}
+
+// Programs loaded with constant propagation, compare with BM_RunProgram on the same engine.
+void BM_RunPropagated(benchmark::State& state)
+{
+    const auto program{make_program(state)};
+    const auto engine{static_cast<ExecutionEngine>(state.range(2))};
+    for (auto _ : state)
+    {
+        state.PauseTiming();
+        Machine machine{};
+        machine.set_engine(engine);
+        machine.set_constant_propagation(true);
+        machine.load_program(program);
+        state.ResumeTiming();
+        machine.run_program();
+        benchmark::DoNotOptimize(&machine);
+    }
+    set_instruction_counters(state, executed_instructions(program));
+}
+
+// Programs loaded the way assembler_interpreter() loads them, compare with BM_RunPropagated on the same engine.
+void BM_RunOptimized(benchmark::State& state)
+{
+    const auto program{make_program(state)};
+    const auto engine{static_cast<ExecutionEngine>(state.range(2))};
+    for (auto _ : state)
+    {
+        state.PauseTiming();
+        Machine machine{};
+        machine.set_engine(engine);
+        machine.set_constant_propagation(true);
+        machine.set_dead_code_elimination(DeadCodeElimination::OutputOnly);
+        machine.load_program(program);
+        state.ResumeTiming();
+        machine.run_program();
+        benchmark::DoNotOptimize(&machine);
+    }
+    set_instruction_counters(state, executed_instructions(program));
+}
+
+// Source to output through the cache, only the first iteration parses.
+void BM_RunCachedProgram(benchmark::State& state)
+{
+    const auto program{make_program(state)};
+    ProgramCache cache{16};
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(assembler_interpreter(program, cache));
+    }
+    set_instruction_counters(state, executed_instructions(program));
+}
+
+void BM_RunBatch(benchmark::State& state)
+{
+    const std::vector<std::string> programs(1000, loop_program(1000));
+    const auto workers{static_cast<unsigned int>(state.range(0))};
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(assembler_interpreter_batch(programs, workers));
+    }
+    state.SetItemsProcessed(state.iterations() * programs.size());
+}
+
+void batch_arguments(benchmark::internal::Benchmark* benchmark)
+{
+    benchmark->ArgNames({"workers"});
+    for (unsigned int workers{1}; workers <= std::max(std::thread::hardware_concurrency(), 1u); workers *= 2)
+    {
+        benchmark->Arg(workers);
+    }
+    benchmark->UseRealTime();
+}
+
+void trace_arguments(benchmark::internal::Benchmark* benchmark)
+{
+    benchmark->ArgNames({"workload", "size"});
+    benchmark->Args({static_cast<int>(Workload::StraightLine), 10000});
+    benchmark->Args({static_cast<int>(Workload::Recursion), 10000});
+    benchmark->Args({static_cast<int>(Workload::Messages), 10000});
+}
+
+void load_arguments(benchmark::internal::Benchmark* benchmark)
+{
+    benchmark->ArgNames({"workload", "size"});
+    for (auto workload : {Workload::Factorial, Workload::Fibonacci, Workload::Gcd, Workload::Power})
+    {
+        benchmark->Args({static_cast<int>(workload), 0});
+    }
+    for (auto size : {1000, 100000})
+    {
+        benchmark->Args({static_cast<int>(Workload::StraightLine), size});
+    }
+}
+
+void lockstep_arguments(benchmark::internal::Benchmark* benchmark)
+{
+    benchmark->ArgNames({"workload", "size", "lanes"});
+    for (auto lanes : {1, 8, 64, 1024})
+    {
+        benchmark->Args({static_cast<int>(Workload::Factorial), 0, lanes});
+        benchmark->Args({static_cast<int>(Workload::StraightLine), 1000, lanes});
+        benchmark->Args({static_cast<int>(Workload::Loop), 100, lanes});
+        benchmark->Args({static_cast<int>(Workload::KnownValues), 100, lanes});
+    }
+}
+
+void run_arguments(benchmark::internal::Benchmark* benchmark)
+{
+    benchmark->ArgNames({"workload", "size", "engine"});
+    for (auto engine :
+         {ExecutionEngine::Reference, ExecutionEngine::Bytecode, ExecutionEngine::Threaded, ExecutionEngine::Jit})
+    {
+        const auto engine_argument{static_cast<int>(engine)};
+        for (auto workload : {Workload::Factorial, Workload::Fibonacci, Workload::Gcd, Workload::Power})
+        {
+            benchmark->Args({static_cast<int>(workload), 0, engine_argument});
+        }
+        benchmark->Args({static_cast<int>(Workload::StraightLine), 10000, engine_argument});
+        benchmark->Args({static_cast<int>(Workload::Loop), 100000, engine_argument});
+        benchmark->Args({static_cast<int>(Workload::Recursion), 10000, engine_argument});
+        benchmark->Args({static_cast<int>(Workload::Messages), 10000, engine_argument});
+        benchmark->Args({static_cast<int>(Workload::KnownValues), 100000, engine_argument});
+    }
+}
+}  // namespace
+
+BENCHMARK(BM_ParseProgram)->Apply(load_arguments);
+BENCHMARK(BM_DecodeProgramImage)->Apply(load_arguments);
+BENCHMARK(BM_PreRun)->Apply(load_arguments);
+BENCHMARK(BM_RunProgram)->Apply(run_arguments);
+BENCHMARK(BM_RunWide)->Apply(run_arguments);
+BENCHMARK(BM_RunLockstep)->Apply(lockstep_arguments);
+BENCHMARK(BM_RunPropagated)->Apply(run_arguments);
+BENCHMARK(BM_RunOptimized)->Apply(run_arguments);
+BENCHMARK(BM_RunTraced)->Apply(trace_arguments);
+BENCHMARK(BM_RunLimited)->Apply(trace_arguments);
+BENCHMARK(BM_RunCachedProgram)->Apply(load_arguments);
+BENCHMARK(BM_RunBatch)->Apply(batch_arguments);
@@ -0,0 +1,134 @@
+#include "assembler_interpreter/bench/counting_allocator.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+// Every replaceable allocation function is replaced, they all allocate through aligned_alloc, so every deallocation
+// function can free.
+std::atomic<std::uint64_t> allocation_count{0};
+
+namespace
+{
+void* allocate(std::size_t size, std::size_t alignment) noexcept
+{
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    alignment = std::max(alignment, alignof(std::max_align_t));
+    const auto rounded{(std::max(size, std::size_t{1}) + alignment - 1) / alignment * alignment};
+    return std::aligned_alloc(alignment, rounded);
+}
+
+void* allocate_or_throw(std::size_t size, std::size_t alignment)
+{
+    if (void* const memory{allocate(size, alignment)})
+    {
+        return memory;
+    }
+    throw std::bad_alloc{};
+}
+
+void release(void* memory) noexcept
+{
+    std::free(memory);
+}
+}  // namespace
+
+void* operator new(std::size_t size)
+{
+    return allocate_or_throw(size, alignof(std::max_align_t));
+}
+
+void* operator new[](std::size_t size)
+{
+    return allocate_or_throw(size, alignof(std::max_align_t));
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+    return allocate_or_throw(size, static_cast<std::size_t>(alignment));
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment)
+{
+    return allocate_or_throw(size, static_cast<std::size_t>(alignment));
+}
+
+void* operator new(std::size_t size, std::nothrow_t const&) noexcept
+{
+    return allocate(size, alignof(std::max_align_t));
+}
+
+void* operator new[](std::size_t size, std::nothrow_t const&) noexcept
+{
+    return allocate(size, alignof(std::max_align_t));
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment, std::nothrow_t const&) noexcept
+{
+    return allocate(size, static_cast<std::size_t>(alignment));
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment, std::nothrow_t const&) noexcept
+{
+    return allocate(size, static_cast<std::size_t>(alignment));
+}
+
+void operator delete(void* memory) noexcept
+{
+    release(memory);
+}
+
+void operator delete[](void* memory) noexcept
+{
+    release(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept
+{
+    release(memory);
+}
+
+void operator delete[](void* memory, std::size_t) noexcept
+{
+    release(memory);
+}
+
+void operator delete(void* memory, std::align_val_t) noexcept
+{
+    release(memory);
+}
+
+void operator delete[](void* memory, std::align_val_t) noexcept
+{
+    release(memory);
+}
+
+void operator delete(void* memory, std::size_t, std::align_val_t) noexcept
+{
+    release(memory);
+}
+
+void operator delete[](void* memory, std::size_t, std::align_val_t) noexcept
+{
+    release(memory);
+}
+
+void operator delete(void* memory, std::nothrow_t const&) noexcept
+{
+    release(memory);
+}
+
+void operator delete[](void* memory, std::nothrow_t const&) noexcept
+{
+    release(memory);
+}
+
+void operator delete(void* memory, std::align_val_t, std::nothrow_t const&) noexcept
+{
+    release(memory);
+}
+
+void operator delete[](void* memory, std::align_val_t, std::nothrow_t const&) noexcept
+{
+    release(memory);
+}
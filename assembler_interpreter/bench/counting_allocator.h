@@ -0,0 +1,11 @@
+#ifndef COUNTING_ALLOCATOR_H
+#define COUNTING_ALLOCATOR_H
+
+#include <atomic>
+#include <cstdint>
+
+// Heap allocations of the process so far. Benchmarks linking counting_allocator count them, so they can report how
+// many a load takes.
+extern std::atomic<std::uint64_t> allocation_count;
+
+#endif /* COUNTING_ALLOCATOR_H */
@@ -1,7 +1,41 @@
 #ifndef MAIN_H
 #define MAIN_H
 
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Reference walks the parsed instruction objects, Bytecode runs the compiled form of the same program
+// through a switch loop and Threaded runs it with direct threaded dispatch. Jit translates the compiled form
+// to native code on x86-64 hosts and falls back to Threaded elsewhere.
+enum class ExecutionEngine
+{
+    Reference,
+    Bytecode,
+    Threaded,
+    Jit
+};
+
+class ProgramCache;
+
 std::unordered_map<std::string, int> assembler(std::vector<std::string> const& program);
 std::string assembler_interpreter(std::string program);
+std::string assembler_interpreter(std::string program, ExecutionEngine engine);
+std::string assembler_interpreter(std::string const& program, ProgramCache& cache);
+
+// The same entry points for registers of another width, assembler<std::int64_t> and
+// assembler_interpreter<std::int64_t> run programs whose values overflow 32 bits. The overloads above run with
+// std::int32_t, the programs of a ProgramCache always do.
+template <typename Word>
+std::unordered_map<std::string, Word> assembler(std::vector<std::string> const& program);
+template <typename Word>
+std::string assembler_interpreter(std::string program, ExecutionEngine engine);
+
+// Runs independent programs on up to `workers` threads, all available cores when zero, and returns their
+// outputs in the order of the programs. The calling thread takes part, the others come from a pool of threads
+// shared by all batches and kept between them.
+std::vector<std::string> assembler_interpreter_batch(std::vector<std::string> const& programs,
+                                                     unsigned int workers = 0,
+                                                     ExecutionEngine engine = ExecutionEngine::Threaded);
 
 #endif /* MAIN_H */
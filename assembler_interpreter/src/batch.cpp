@@ -0,0 +1,144 @@
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include "assembler_interpreter/src/assembler_main.h"
+
+namespace
+{
+// Threads started by the first batch needing them and kept for every later one, until the process exits. A
+// batch queues one task per helper it wants, all running the same job, and waits until each of them returned.
+class WorkerPool
+{
+  public:
+    static WorkerPool& instance()
+    {
+        static WorkerPool pool{};
+        return pool;
+    }
+
+    WorkerPool(WorkerPool const&) = delete;
+    WorkerPool& operator=(WorkerPool const&) = delete;
+    ~WorkerPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock{mutex_};
+            stopping_ = true;
+        }
+        task_ready_.notify_all();
+        for (auto& thread : threads_)
+        {
+            thread.join();
+        }
+    }
+
+    // Runs job on the calling thread and on `helpers` threads of the pool. Jobs must not throw.
+    void run(std::function<void()> const& job, unsigned int helpers)
+    {
+        Batch batch{job, helpers};
+        {
+            std::lock_guard<std::mutex> lock{mutex_};
+            while (threads_.size() < helpers)
+            {
+                threads_.emplace_back([this]() { work(); });
+            }
+            for (unsigned int helper{0}; helper < helpers; ++helper)
+            {
+                tasks_.push_back(&batch);
+            }
+        }
+        task_ready_.notify_all();
+        job();
+        std::unique_lock<std::mutex> lock{mutex_};
+        batch_done_.wait(lock, [&batch]() { return batch.pending == 0; });
+    }
+
+  private:
+    struct Batch
+    {
+        std::function<void()> const& job;
+        unsigned int pending{0};
+    };
+
+    WorkerPool() = default;
+
+    void work()
+    {
+        std::unique_lock<std::mutex> lock{mutex_};
+        while (true)
+        {
+            task_ready_.wait(lock, [this]() { return stopping_ || !tasks_.empty(); });
+            if (tasks_.empty())
+            {
+                return;
+            }
+            auto* const batch{tasks_.front()};
+            tasks_.pop_front();
+            lock.unlock();
+            batch->job();
+            lock.lock();
+            if (--batch->pending == 0)
+            {
+                batch_done_.notify_all();
+            }
+        }
+    }
+
+    std::mutex mutex_{};
+    std::condition_variable task_ready_{};
+    std::condition_variable batch_done_{};
+    std::deque<Batch*> tasks_{};
+    std::vector<std::thread> threads_{};
+    bool stopping_{false};
+};
+}  // namespace
+
+// Every program runs in its own Machine, so workers share nothing but the index of the next program to take
+// and the first exception thrown, which is rethrown once all of them have finished.
+std::vector<std::string> assembler_interpreter_batch(std::vector<std::string> const& programs,
+                                                     unsigned int workers,
+                                                     ExecutionEngine engine)
+{
+    std::vector<std::string> outputs(programs.size());
+    if (workers == 0)
+    {
+        workers = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+    workers = static_cast<unsigned int>(std::min<std::size_t>(workers, programs.size()));
+    if (workers == 0)
+    {
+        return outputs;
+    }
+
+    std::atomic<std::size_t> next_program{0};
+    std::exception_ptr first_error{};
+    std::mutex error_mutex{};
+    const std::function<void()> work{[&]() {
+        for (auto index{next_program++}; index < programs.size(); index = next_program++)
+        {
+            try
+            {
+                outputs[index] = assembler_interpreter(programs[index], engine);
+            }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> lock{error_mutex};
+                if (!first_error)
+                {
+                    first_error = std::current_exception();
+                }
+            }
+        }
+    }};
+
+    WorkerPool::instance().run(work, workers - 1);
+    if (first_error)
+    {
+        std::rethrow_exception(first_error);
+    }
+    return outputs;
+}
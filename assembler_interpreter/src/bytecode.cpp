@@ -0,0 +1,204 @@
+#include "assembler_interpreter/src/bytecode.h"
+
+#include <charconv>
+#include <iterator>
+#include <limits>
+#include <stdexcept>
+
+void MessageTemplate::add_text(std::string_view text)
+{
+    if (segments_.empty() || segments_.back().has_value)
+    {
+        segments_.emplace_back();
+    }
+    segments_.back().text.append(text);
+}
+
+void MessageTemplate::add_value(Slot slot)
+{
+    if (segments_.empty() || segments_.back().has_value)
+    {
+        segments_.emplace_back();
+    }
+    segments_.back().has_value = true;
+    segments_.back().slot = slot;
+}
+
+template <typename Word>
+void MessageTemplate::render(std::string& output, Word const* slots) const
+{
+    char digits[std::numeric_limits<Word>::digits10 + 3];
+    for (auto const& segment : segments_)
+    {
+        output.append(segment.text);
+        if (segment.has_value)
+        {
+            const auto formatted{std::to_chars(std::begin(digits), std::end(digits), slots[segment.slot])};
+            output.append(digits, formatted.ptr);
+        }
+    }
+}
+
+template void MessageTemplate::render(std::string& output, std::int32_t const* slots) const;
+template void MessageTemplate::render(std::string& output, std::int64_t const* slots) const;
+
+std::vector<MessageTemplate::Segment> const& MessageTemplate::segments() const
+{
+    return segments_;
+}
+
+SlotTable::SlotTable(SlotValue min_value, SlotValue max_value) : min_value_{min_value}, max_value_{max_value} {}
+
+Slot SlotTable::register_slot(std::string const& name)
+{
+    const auto found{register_slots_.find(name)};
+    if (found != register_slots_.end())
+    {
+        return found->second;
+    }
+    const auto slot{add_slot(name, 0)};
+    register_slots_.emplace(name, slot);
+    return slot;
+}
+
+Slot SlotTable::operand_slot(std::string const& operand)
+{
+    if (is_register(operand))
+    {
+        return register_slot(operand);
+    }
+    const SlotValue value{std::stoll(operand)};
+    if (value < min_value_ || value > max_value_)
+    {
+        throw std::out_of_range{"Immediate out of range: " + operand};
+    }
+    const auto found{constant_slots_.find(value)};
+    if (found != constant_slots_.end())
+    {
+        return found->second;
+    }
+    const auto slot{add_slot({}, value)};
+    constant_slots_.emplace(value, slot);
+    return slot;
+}
+
+std::vector<std::string> const& SlotTable::names() const
+{
+    return names_;
+}
+
+std::vector<SlotValue> const& SlotTable::initial_values() const
+{
+    return initial_values_;
+}
+
+Slot SlotTable::add_slot(std::string name, SlotValue initial_value)
+{
+    names_.push_back(std::move(name));
+    initial_values_.push_back(initial_value);
+    return static_cast<Slot>(names_.size() - 1);
+}
+
+char const* opcode_name(OpCode code)
+{
+    static char const* const names[]{"mov",     "inc",    "dec",     "add",    "sub",     "mul",    "div",
+                                     "jmp",     "jnz",    "jnz",     "cmp",    "jne",     "je",     "jge",
+                                     "jg",      "jle",    "jl",      "call",   "ret",     "msg",    "end",
+                                     "cmp+jne", "cmp+je", "cmp+jge", "cmp+jg", "cmp+jle", "cmp+jl", "dec+jnz",
+                                     "loop",    "call+ret"};
+    static_assert(sizeof(names) / sizeof(names[0]) == static_cast<std::size_t>(OpCode::TailCall) + 1,
+                  "Every opcode needs a name");
+    return names[static_cast<std::size_t>(code)];
+}
+
+std::size_t Bytecode::slot_count() const
+{
+    return initial_slot_values.size();
+}
+
+bool Bytecode::is_constant(Slot slot) const
+{
+    return slot_names[slot].empty();
+}
+
+std::uint32_t Bytecode::relative_jump_target(std::size_t source_index, std::ptrdiff_t distance) const
+{
+    const auto source_size{source_to_code.size() - 1};
+    return source_to_code[resolve_relative_jump(source_index, distance, source_size)];
+}
+
+std::size_t resolve_relative_jump(std::size_t source_index, std::ptrdiff_t distance, std::size_t source_size)
+{
+    const auto size{static_cast<std::ptrdiff_t>(source_size)};
+    const auto target{static_cast<std::ptrdiff_t>(source_index) + distance};
+    const bool is_target_in_range{target >= 1 && target <= size + 1};
+    const auto resolved{is_target_in_range ? target : static_cast<std::ptrdiff_t>(source_index) + 2};
+    return static_cast<std::size_t>(std::min(resolved, size));
+}
+
+BytecodeBuilder::BytecodeBuilder(std::size_t source_size, SlotTable const& slot_table) : source_size_{source_size}
+{
+    bytecode_.slot_names = slot_table.names();
+    bytecode_.initial_slot_values = slot_table.initial_values();
+    bytecode_.source_to_code.resize(source_size + 1, 0);
+}
+
+void BytecodeBuilder::begin_instruction(std::size_t source_index)
+{
+    source_index_ = source_index;
+    bytecode_.source_to_code[source_index] = static_cast<std::uint32_t>(bytecode_.code.size());
+}
+
+void BytecodeBuilder::define_label(std::string_view name)
+{
+    labels_[std::string{name}] = source_index_;
+}
+
+void BytecodeBuilder::emit(OpCode code, std::uint32_t a, std::uint32_t b, std::uint32_t c)
+{
+    bytecode_.code.push_back({code, a, b, c});
+}
+
+void BytecodeBuilder::emit_label_jump(OpCode code, std::string_view label)
+{
+    label_fixups_.emplace_back(bytecode_.code.size(), std::string{label});
+    emit(code);
+}
+
+void BytecodeBuilder::emit_relative_jump(OpCode code, std::ptrdiff_t distance, std::uint32_t b)
+{
+    source_fixups_.emplace_back(bytecode_.code.size(), resolve_relative_jump(source_index_, distance, source_size_));
+    emit(code, 0, b);
+}
+
+std::uint32_t BytecodeBuilder::add_message(MessageTemplate message)
+{
+    bytecode_.messages.push_back(std::move(message));
+    return static_cast<std::uint32_t>(bytecode_.messages.size() - 1);
+}
+
+std::size_t BytecodeBuilder::current_source_index() const
+{
+    return source_index_;
+}
+
+Bytecode BytecodeBuilder::finish()
+{
+    auto& code{bytecode_.code};
+    auto& source_to_code{bytecode_.source_to_code};
+    source_to_code[source_size_] = static_cast<std::uint32_t>(code.size());
+    for (auto const& fixup : source_fixups_)
+    {
+        code[fixup.first].a = source_to_code[fixup.second];
+    }
+    for (auto const& fixup : label_fixups_)
+    {
+        const auto label{labels_.find(fixup.second)};
+        if (label == labels_.end())
+        {
+            throw std::out_of_range("Unknown label: " + fixup.second);
+        }
+        code[fixup.first].a = source_to_code[label->second];
+    }
+    return std::move(bytecode_);
+}
@@ -0,0 +1,265 @@
+#ifndef BYTECODE_H
+#define BYTECODE_H
+
+#include <algorithm>
+#include <cctype>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Values slots hold in a bytecode. Compiled programs do not depend on the word size of the machines running them,
+// so their values are stored at the widest one.
+using SlotValue = std::int64_t;
+using Slot = std::uint32_t;
+
+// Arithmetic of the machines. Results wrap around modulo 2^N for an N bit Word instead of overflowing, they are
+// computed in the unsigned type of the same width. Division by zero is the one operation left undefined.
+template <typename Word>
+Word wrapping_add(Word lhs, Word rhs)
+{
+    using Unsigned = std::make_unsigned_t<Word>;
+    return static_cast<Word>(static_cast<Unsigned>(lhs) + static_cast<Unsigned>(rhs));
+}
+
+template <typename Word>
+Word wrapping_subtract(Word lhs, Word rhs)
+{
+    using Unsigned = std::make_unsigned_t<Word>;
+    return static_cast<Word>(static_cast<Unsigned>(lhs) - static_cast<Unsigned>(rhs));
+}
+
+template <typename Word>
+Word wrapping_multiply(Word lhs, Word rhs)
+{
+    using Unsigned = std::make_unsigned_t<Word>;
+    return static_cast<Word>(static_cast<Unsigned>(lhs) * static_cast<Unsigned>(rhs));
+}
+
+// Truncates toward zero. The only quotient that does not fit, min() / -1, wraps around to min().
+template <typename Word>
+Word wrapping_divide(Word lhs, Word rhs)
+{
+    return (rhs == -1) ? wrapping_subtract(Word{0}, lhs) : lhs / rhs;
+}
+
+inline bool is_register(std::string_view val)
+{
+    const auto result{std::find_if(val.begin(), val.end(), [](auto const& c) { return std::isalpha(c); })};
+    return result != val.end();
+}
+
+enum class OpCode : std::uint8_t
+{
+    Mov,
+    Inc,
+    Dec,
+    Add,
+    Sub,
+    Mul,
+    Div,
+    Jmp,
+    Jnz,
+    JnzDynamic,
+    Cmp,
+    Jne,
+    Je,
+    Jge,
+    Jg,
+    Jle,
+    Jl,
+    Call,
+    Ret,
+    Msg,
+    End,
+    CmpJne,
+    CmpJe,
+    CmpJge,
+    CmpJg,
+    CmpJle,
+    CmpJl,
+    DecJnz,
+    CountedLoop,
+    TailCall
+};
+
+// Mnemonic of an opcode, fused ones join the mnemonics of the instructions they replace.
+char const* opcode_name(OpCode code);
+
+// Operand layout per opcode:
+//   arithmetic, mov, cmp: a = destination (or lhs) slot, b = source (or rhs) slot
+//   jmp, jcc, call:       a = code index of the jump target
+//   jnz:                  a = code index of the jump target, b = condition slot
+//   jnz (dynamic):        a = source index of the jnz, b = condition slot, c = distance slot
+//   msg:                  a = index into Bytecode::messages
+//   cmp + jcc:            a = lhs slot, b = rhs slot, c = code index of the jump target
+//   dec + jnz:            a = decremented slot, c = code index of the jump target
+//   counted loop:         a = index into Bytecode::loops
+//   call + ret:           a = code index of the callee
+// Fused ops keep the op they absorbed behind them, so jumps to the second op of a pair stay valid. Falling
+// through a fused op skips that op.
+struct Op
+{
+    OpCode code{OpCode::End};
+    std::uint32_t a{0};
+    std::uint32_t b{0};
+    std::uint32_t c{0};
+};
+
+// Arguments of a msg split at load time into runs of literal text, each followed by the slot printed after it.
+class MessageTemplate
+{
+  public:
+    struct Segment
+    {
+        std::string text{};
+        bool has_value{false};
+        Slot slot{0};
+    };
+
+    void add_text(std::string_view text);
+    void add_value(Slot slot);
+    template <typename Word>
+    void render(std::string& output, Word const* slots) const;
+    std::vector<Segment> const& segments() const;
+
+  private:
+    std::vector<Segment> segments_{};
+};
+
+// Change of a slot over one iteration of a counted loop: the constant step plus the values of the loop
+// invariant slots added and subtracted.
+struct LoopStep
+{
+    Slot slot{0};
+    std::int64_t constant{0};
+    std::vector<Slot> added{};
+    std::vector<Slot> subtracted{};
+};
+
+// Backward branch closing a loop whose body only adds loop invariant values to its slots. The loop runs on
+// while `counter relation bound` holds, relation being one of the fused compare-and-jump codes, or Jnz for a
+// comparison against zero. backedge is the replaced branch, counter_step the index of the counter in steps.
+struct CountedLoop
+{
+    Op backedge{};
+    OpCode relation{OpCode::Jnz};
+    Slot counter{0};
+    Slot bound{0};
+    std::uint32_t head{0};
+    std::uint32_t exit{0};
+    std::size_t counter_step{0};
+    std::vector<LoopStep> steps{};
+};
+
+// Dense layout of every value an instruction refers to. Register names and immediates are interned at load
+// time, named slots are the registers of the program, unnamed slots hold its immediate values. Registers start at
+// 0, so reading one the program did not write yet yields 0. Immediates outside [min_value, max_value] throw
+// std::out_of_range.
+class SlotTable
+{
+  public:
+    SlotTable() = default;
+    SlotTable(SlotValue min_value, SlotValue max_value);
+    Slot register_slot(std::string const& name);
+    Slot operand_slot(std::string const& operand);
+    std::vector<std::string> const& names() const;
+    std::vector<SlotValue> const& initial_values() const;
+
+  private:
+    Slot add_slot(std::string name, SlotValue initial_value);
+
+    SlotValue min_value_{std::numeric_limits<SlotValue>::min()};
+    SlotValue max_value_{std::numeric_limits<SlotValue>::max()};
+    std::vector<std::string> names_{};
+    std::vector<SlotValue> initial_values_{};
+    std::unordered_map<std::string, Slot> register_slots_{};
+    std::unordered_map<SlotValue, Slot> constant_slots_{};
+};
+
+class JitCode;
+
+// Native code the Jit engine translated a bytecode to, one translation per word size. The first machine running the
+// bytecode on the Jit engine translates it, every later one, on any thread, reuses that. Copies start untranslated.
+class NativeCode
+{
+  public:
+    NativeCode() = default;
+    NativeCode(NativeCode const&) {}
+    NativeCode& operator=(NativeCode const&)
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+        translations_.clear();
+        return *this;
+    }
+    // Calls translate for the first request of a word size only, a null translation is kept like any other.
+    template <typename Translate>
+    std::shared_ptr<JitCode> get(std::size_t word_size, Translate translate) const
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+        const auto translation{std::find_if(translations_.begin(), translations_.end(), [word_size](auto const& entry) {
+            return entry.first == word_size;
+        })};
+        if (translation != translations_.end())
+        {
+            return translation->second;
+        }
+        translations_.emplace_back(word_size, translate());
+        return translations_.back().second;
+    }
+
+  private:
+    mutable std::mutex mutex_{};
+    mutable std::vector<std::pair<std::size_t, std::shared_ptr<JitCode>>> translations_{};
+};
+
+// Flat, fully resolved form of a loaded program. Every operand is an index into the slot array.
+struct Bytecode
+{
+    std::vector<Op> code{};
+    std::vector<std::string> slot_names{};
+    std::vector<SlotValue> initial_slot_values{};
+    std::vector<MessageTemplate> messages{};
+    std::vector<CountedLoop> loops{};
+    std::vector<std::uint32_t> source_to_code{};
+    NativeCode native_code{};
+
+    std::size_t slot_count() const;
+    bool is_constant(Slot slot) const;
+    std::uint32_t relative_jump_target(std::size_t source_index, std::ptrdiff_t distance) const;
+};
+
+// Resolves the instruction pointer a relative jump of the source program lands on, out of range jumps
+// continue behind the instruction following the jump.
+std::size_t resolve_relative_jump(std::size_t source_index, std::ptrdiff_t distance, std::size_t source_size);
+
+class BytecodeBuilder
+{
+  public:
+    BytecodeBuilder(std::size_t source_size, SlotTable const& slot_table);
+    void begin_instruction(std::size_t source_index);
+    void define_label(std::string_view name);
+    void emit(OpCode code, std::uint32_t a = 0, std::uint32_t b = 0, std::uint32_t c = 0);
+    void emit_label_jump(OpCode code, std::string_view label);
+    void emit_relative_jump(OpCode code, std::ptrdiff_t distance, std::uint32_t b = 0);
+    std::uint32_t add_message(MessageTemplate message);
+    std::size_t current_source_index() const;
+    Bytecode finish();
+
+  private:
+    Bytecode bytecode_{};
+    std::size_t source_size_{0};
+    std::size_t source_index_{0};
+    std::unordered_map<std::string, std::size_t> labels_{};
+    std::vector<std::pair<std::size_t, std::string>> label_fixups_{};
+    std::vector<std::pair<std::size_t, std::size_t>> source_fixups_{};
+};
+
+#endif /* BYTECODE_H */
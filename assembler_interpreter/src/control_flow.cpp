@@ -0,0 +1,157 @@
+#include "assembler_interpreter/src/control_flow.h"
+
+#include <algorithm>
+
+namespace
+{
+// Code indices execution can go on at after an op, the index behind the last op leaving the program. Branching
+// ops are the ones that can go on anywhere but at the next op.
+struct Continuations
+{
+    std::uint32_t next[2]{0, 0};
+    std::uint32_t count{0};
+    bool branches{false};
+};
+
+Continuations continuations_of(Bytecode const& program, std::uint32_t index)
+{
+    auto const& op{program.code[index]};
+    switch (op.code)
+    {
+        case OpCode::Jmp:
+        case OpCode::TailCall:
+            return {{op.a}, 1, true};
+        case OpCode::Jnz:
+        case OpCode::Jne:
+        case OpCode::Je:
+        case OpCode::Jge:
+        case OpCode::Jg:
+        case OpCode::Jle:
+        case OpCode::Jl:
+        case OpCode::Call:
+            return {{op.a, index + 1}, 2, true};
+        case OpCode::CmpJne:
+        case OpCode::CmpJe:
+        case OpCode::CmpJge:
+        case OpCode::CmpJg:
+        case OpCode::CmpJle:
+        case OpCode::CmpJl:
+        case OpCode::DecJnz:
+            return {{op.c, index + 2}, 2, true};
+        case OpCode::CountedLoop:
+            return {{program.loops[op.a].head, program.loops[op.a].exit}, 2, true};
+        case OpCode::JnzDynamic:
+            return {{index + 1}, 1, true};
+        case OpCode::Ret:
+        case OpCode::End:
+            return {{}, 0, true};
+        default:
+            return {{index + 1}, 1, false};
+    }
+}
+
+void add_edge(std::vector<BasicBlock>& blocks, std::uint32_t from, std::uint32_t to)
+{
+    auto& successors{blocks[from].successors};
+    if (std::find(successors.begin(), successors.end(), to) == successors.end())
+    {
+        successors.push_back(to);
+        blocks[to].predecessors.push_back(from);
+    }
+}
+}  // namespace
+
+ControlFlowGraph::ControlFlowGraph(Bytecode const& program)
+{
+    auto const& code{program.code};
+    const auto size{static_cast<std::uint32_t>(code.size())};
+    has_dynamic_jumps_ = std::any_of(code.begin(), code.end(), [](auto const& op) {
+        return op.code == OpCode::JnzDynamic;
+    });
+
+    std::vector<std::uint8_t> leaders(size + 1, has_dynamic_jumps_ ? 1 : 0);
+    leaders[0] = 1;
+    for (std::uint32_t index{0}; index < size; ++index)
+    {
+        const auto continuations{continuations_of(program, index)};
+        if (continuations.branches)
+        {
+            leaders[index + 1] = 1;
+            for (std::uint32_t next{0}; next < continuations.count; ++next)
+            {
+                leaders[std::min(continuations.next[next], size)] = 1;
+            }
+        }
+    }
+
+    block_of_op_.resize(size);
+    for (std::uint32_t index{0}; index < size; ++index)
+    {
+        if (leaders[index])
+        {
+            blocks_.push_back({index, index});
+        }
+        blocks_.back().end = index + 1;
+        block_of_op_[index] = static_cast<std::uint32_t>(blocks_.size() - 1);
+    }
+
+    for (std::uint32_t block{0}; block < blocks_.size(); ++block)
+    {
+        const auto last{blocks_[block].end - 1};
+        const auto continuations{continuations_of(program, last)};
+        for (std::uint32_t next{0}; next < continuations.count; ++next)
+        {
+            if (continuations.next[next] < size)
+            {
+                add_edge(blocks_, block, block_of_op_[continuations.next[next]]);
+            }
+        }
+        if (code[last].code == OpCode::JnzDynamic)
+        {
+            for (std::uint32_t target{0}; target < blocks_.size(); ++target)
+            {
+                add_edge(blocks_, block, target);
+            }
+        }
+    }
+}
+
+std::vector<BasicBlock> const& ControlFlowGraph::blocks() const
+{
+    return blocks_;
+}
+
+std::uint32_t ControlFlowGraph::block_of(std::uint32_t op) const
+{
+    return block_of_op_[op];
+}
+
+bool ControlFlowGraph::has_dynamic_jumps() const
+{
+    return has_dynamic_jumps_;
+}
+
+std::vector<bool> ControlFlowGraph::reachable_blocks() const
+{
+    std::vector<bool> reachable(blocks_.size(), false);
+    if (blocks_.empty())
+    {
+        return reachable;
+    }
+    std::vector<std::uint32_t> pending{0};
+    reachable[0] = true;
+    while (!pending.empty())
+    {
+        const auto block{pending.back()};
+        pending.pop_back();
+        for (auto successor : blocks_[block].successors)
+        {
+            if (!reachable[successor])
+            {
+                reachable[successor] = true;
+                pending.push_back(successor);
+            }
+        }
+    }
+    return reachable;
+}
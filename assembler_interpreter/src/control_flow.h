@@ -0,0 +1,38 @@
+#ifndef CONTROL_FLOW_H
+#define CONTROL_FLOW_H
+
+#include <cstdint>
+#include <vector>
+#include "assembler_interpreter/src/bytecode.h"
+
+// Ops [begin, end) of a bytecode, only ever entered at begin and left after end - 1. Successors and predecessors
+// are indices of blocks.
+struct BasicBlock
+{
+    std::uint32_t begin{0};
+    std::uint32_t end{0};
+    std::vector<std::uint32_t> successors{};
+    std::vector<std::uint32_t> predecessors{};
+};
+
+// Basic blocks of a bytecode in code order, the first one is the entry. A block ending in a call has the callee
+// and the op behind the call as successors. Blocks ending the program, returning or jumping behind the last op
+// have none. A jnz whose distance is a register can land on any op, in programs containing one every op is a
+// block of its own and that jnz has every block as a successor.
+class ControlFlowGraph
+{
+  public:
+    explicit ControlFlowGraph(Bytecode const& program);
+    std::vector<BasicBlock> const& blocks() const;
+    std::uint32_t block_of(std::uint32_t op) const;
+    bool has_dynamic_jumps() const;
+    // Whether each block can run at all, following successors from the entry.
+    std::vector<bool> reachable_blocks() const;
+
+  private:
+    std::vector<BasicBlock> blocks_{};
+    std::vector<std::uint32_t> block_of_op_{};
+    bool has_dynamic_jumps_{false};
+};
+
+#endif /* CONTROL_FLOW_H */
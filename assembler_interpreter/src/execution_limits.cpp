@@ -0,0 +1,40 @@
+#include "assembler_interpreter/src/execution_limits.h"
+
+#include <algorithm>
+#include <limits>
+
+Limiter::Limiter(ExecutionLimits const& limits)
+    : max_instructions_{limits.max_instructions != 0 ? limits.max_instructions
+                                                     : std::numeric_limits<std::uint64_t>::max()},
+      has_deadline_{limits.max_wall_time.count() != 0},
+      deadline_{has_deadline_ ? std::chrono::steady_clock::now() + limits.max_wall_time
+                              : std::chrono::steady_clock::time_point{}},
+      next_clock_read_{has_deadline_ ? clock_interval : std::numeric_limits<std::uint64_t>::max()},
+      next_check_{std::min(max_instructions_, next_clock_read_)}
+{
+}
+
+RunStatus Limiter::status() const
+{
+    return status_;
+}
+
+bool Limiter::check(std::uint64_t executed)
+{
+    if (executed >= max_instructions_)
+    {
+        status_ = RunStatus::InstructionLimit;
+        return true;
+    }
+    if (executed >= next_clock_read_)
+    {
+        if (std::chrono::steady_clock::now() >= deadline_)
+        {
+            status_ = RunStatus::TimeLimit;
+            return true;
+        }
+        next_clock_read_ = executed + clock_interval;
+    }
+    next_check_ = std::min(max_instructions_, next_clock_read_);
+    return false;
+}
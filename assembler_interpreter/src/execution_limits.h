@@ -0,0 +1,111 @@
+#ifndef EXECUTION_LIMITS_H
+#define EXECUTION_LIMITS_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include "assembler_interpreter/src/bytecode.h"
+
+// Bounds of a single run, zero leaves a bound out. The call depth bounds the return stack of every engine, the
+// other bounds need a counted run.
+struct ExecutionLimits
+{
+    std::uint64_t max_instructions{0};
+    std::size_t max_call_depth{0};
+    std::chrono::nanoseconds max_wall_time{0};
+
+    bool counted() const
+    {
+        return max_instructions != 0 || max_wall_time.count() != 0;
+    }
+};
+
+// How a run stopped. Finished runs went past their last op or returned from the top level without reaching
+// end, the others were preempted by a limit and leave their registers as they were at that point.
+enum class RunStatus
+{
+    Ended,
+    Finished,
+    InstructionLimit,
+    CallDepthLimit,
+    TimeLimit
+};
+
+// Enforces the instruction and time limits on a run. Ops are counted as they execute, the limits are only
+// checked at backward branches, which every loop and every recursion takes. The clock is read every
+// clock_interval instructions only, so a run overshoots its limits by at most that many instructions plus one
+// pass through its straight line code.
+class Limiter
+{
+  public:
+    static constexpr std::uint64_t clock_interval{1 << 16};
+
+    explicit Limiter(ExecutionLimits const& limits);
+    bool exceeded(std::uint64_t executed)
+    {
+        if (executed < next_check_)
+        {
+            return false;
+        }
+        return check(executed);
+    }
+    RunStatus status() const;
+
+  private:
+    bool check(std::uint64_t executed);
+
+    std::uint64_t max_instructions_{0};
+    bool has_deadline_{false};
+    std::chrono::steady_clock::time_point deadline_{};
+    std::uint64_t next_clock_read_{0};
+    std::uint64_t next_check_{0};
+    RunStatus status_{RunStatus::Finished};
+};
+
+// Hooks running the hooks of a profiled, traced or plain run under a Limiter.
+template <typename Hooks>
+class Limited
+{
+  public:
+    Limited(Hooks& hooks, ExecutionLimits const& limits) : hooks_{hooks}, limiter_{limits} {}
+    void execute(std::uint32_t op)
+    {
+        ++executed_;
+        hooks_.execute(op);
+    }
+    void call(std::uint32_t target)
+    {
+        hooks_.call(target);
+    }
+    void ret()
+    {
+        hooks_.ret();
+    }
+    void tail_call(std::uint32_t target)
+    {
+        hooks_.tail_call(target);
+    }
+    void retire(std::uint32_t ip, Op const& op, unsigned int flags)
+    {
+        hooks_.retire(ip, op, flags);
+    }
+    bool preempt()
+    {
+        return limiter_.exceeded(executed_);
+    }
+    std::uint64_t executed() const
+    {
+        return executed_;
+    }
+    RunStatus status() const
+    {
+        return limiter_.status();
+    }
+
+  private:
+    Hooks& hooks_;
+    Limiter limiter_;
+    std::uint64_t executed_{0};
+};
+
+#endif /* EXECUTION_LIMITS_H */
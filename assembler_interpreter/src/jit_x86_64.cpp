@@ -0,0 +1,538 @@
+#include "assembler_interpreter/src/machine.h"
+
+#if defined(__x86_64__) && (defined(__linux__) || defined(__APPLE__))
+
+#include <sys/mman.h>
+#include <cstring>
+#include <exception>
+
+// Native code of a compiled program. The slot array, the touched flags, the machine and the jump table are
+// pinned in rbx, r12, r13 and r15 for the whole run, the comparison flags live in r14d. Everything that
+// touches the machine beyond its slots goes through the JitRuntime helpers of its word size.
+class JitCode
+{
+  public:
+    using Entry = unsigned int (*)(void* slots, std::uint8_t* touched, void* machine, void const* const* table,
+                                   unsigned int flags);
+
+    JitCode(std::vector<std::uint8_t> const& code, std::vector<std::size_t> const& op_offsets)
+    {
+        const auto mapped{mmap(nullptr, code.size(), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0)};
+        if (mapped == MAP_FAILED)
+        {
+            return;
+        }
+        std::memcpy(mapped, code.data(), code.size());
+        if (mprotect(mapped, code.size(), PROT_READ | PROT_EXEC) != 0)
+        {
+            munmap(mapped, code.size());
+            return;
+        }
+        memory_ = static_cast<std::uint8_t*>(mapped);
+        size_ = code.size();
+        for (auto offset : op_offsets)
+        {
+            jump_table_.push_back(memory_ + offset);
+        }
+    }
+    JitCode(JitCode const&) = delete;
+    JitCode& operator=(JitCode const&) = delete;
+    ~JitCode()
+    {
+        if (memory_)
+        {
+            munmap(memory_, size_);
+        }
+    }
+
+    bool is_valid() const
+    {
+        return memory_ != nullptr;
+    }
+    unsigned int run(void* slots, std::uint8_t* touched, void* machine, unsigned int flags) const
+    {
+        return reinterpret_cast<Entry>(memory_)(slots, touched, machine, jump_table_.data(), flags);
+    }
+
+  private:
+    std::uint8_t* memory_{nullptr};
+    std::size_t size_{0};
+    std::vector<void const*> jump_table_{};
+};
+
+// Native frames have no unwind information, so no exception may leave a helper called from them. A helper that
+// catches one keeps it on the machine and tells the native code to stop, run_jit rethrows it once the native code
+// returned.
+template <typename Word>
+struct JitRuntime
+{
+    using Machine = BasicMachine<Word>;
+
+    template <typename Function>
+    static bool guarded(Machine* machine, Function function)
+    {
+        try
+        {
+            function();
+            return true;
+        }
+        catch (...)
+        {
+            machine->jit_exception_ = std::current_exception();
+            return false;
+        }
+    }
+    static bool push_return(Machine* machine, std::uint32_t return_address)
+    {
+        bool pushed{false};
+        if (!guarded(machine, [&] { pushed = machine->return_stack_.push(return_address); }))
+        {
+            return false;
+        }
+        if (!pushed)
+        {
+            machine->preempted_by_ = RunStatus::CallDepthLimit;
+        }
+        return pushed;
+    }
+    static std::uint32_t pop_return(Machine* machine)
+    {
+        if (machine->return_stack_.empty())
+        {
+            return static_cast<std::uint32_t>(machine->bytecode_->code.size());
+        }
+        return machine->return_stack_.pop();
+    }
+    static std::uint32_t relative_jump(Machine* machine, std::uint32_t source_index, Word distance)
+    {
+        return machine->bytecode_->relative_jump_target(source_index, distance);
+    }
+    // Stops the run at the end of the program when the loop throws.
+    static std::uint64_t counted_loop(Machine* machine, std::uint32_t loop, unsigned int flags)
+    {
+        std::uint64_t next{machine->bytecode_->code.size()};
+        guarded(machine, [&] {
+            machine->comparison_.set_flags(flags);
+            next = machine->run_counted_loop(loop);
+            next |= std::uint64_t{machine->comparison_.flags()} << 32;
+        });
+        return next;
+    }
+    static bool write_message(Machine* machine, std::uint32_t message)
+    {
+        return guarded(machine, [&] { machine->write_message(message); });
+    }
+    // Native code has no instruction objects to move past, it only records that the program ended.
+    static void end_program(Machine* machine)
+    {
+        machine->ended_ = true;
+    }
+};
+
+namespace
+{
+// Just enough of an x86-64 assembler for the bytecode. Slots are addressed as [rbx + sizeof(Word) * slot] and
+// operated on with the operand size of a Word.
+template <typename Word>
+class Assembler
+{
+  public:
+    std::vector<std::uint8_t> const& code() const
+    {
+        return code_;
+    }
+    std::size_t size() const
+    {
+        return code_.size();
+    }
+
+    void bytes(std::initializer_list<std::uint8_t> values)
+    {
+        code_.insert(code_.end(), values);
+    }
+    void imm32(std::uint32_t value)
+    {
+        for (int shift{0}; shift < 32; shift += 8)
+        {
+            code_.push_back(static_cast<std::uint8_t>(value >> shift));
+        }
+    }
+    void imm64(std::uint64_t value)
+    {
+        imm32(static_cast<std::uint32_t>(value));
+        imm32(static_cast<std::uint32_t>(value >> 32));
+    }
+    void slot(std::uint8_t opcode, std::uint8_t modrm, Slot slot)
+    {
+        word_operand();
+        bytes({opcode, modrm});
+        imm32(slot * sizeof(Word));
+    }
+    // imul eax, [slot]
+    void multiply_eax(Slot source)
+    {
+        word_operand();
+        bytes({0x0F, 0xAF, 0x83});
+        imm32(source * sizeof(Word));
+    }
+    // cdq, or cqo for 64-bit words
+    void sign_extend_eax()
+    {
+        word_operand();
+        bytes({0x99});
+    }
+
+    void load_eax(Slot source)
+    {
+        slot(0x8B, 0x83, source);
+    }
+    void store_eax(Slot destination)
+    {
+        slot(0x89, 0x83, destination);
+    }
+    void mark_touched(Slot touched)
+    {
+        bytes({0x41, 0xC6, 0x84, 0x24});
+        imm32(touched);
+        bytes({0x01});
+    }
+    void set_flags(unsigned int flags)
+    {
+        bytes({0x41, 0xBE});
+        imm32(flags);
+    }
+    // Leaves the cpu flags of `cmp lhs, rhs` intact behind the comparison flags it sets.
+    void compare(Slot lhs, Slot rhs)
+    {
+        load_eax(lhs);
+        slot(0x3B, 0x83, rhs);
+        set_flags(Equal | LessOrEqual | GreaterOrEqual);
+        bytes({0x74, 14});
+        set_flags(NotEqual | Less | LessOrEqual);
+        bytes({0x7C, 6});
+        set_flags(NotEqual | Greater | GreaterOrEqual);
+    }
+    void call(void const* function)
+    {
+        bytes({0x48, 0xB8});
+        imm64(reinterpret_cast<std::uint64_t>(function));
+        bytes({0xFF, 0xD0});
+    }
+    void call_with_index(void const* function, std::uint32_t index)
+    {
+        bytes({0x4C, 0x89, 0xEF});
+        bytes({0xBE});
+        imm32(index);
+        call(function);
+    }
+    // Jumps to the op whose code index is in eax.
+    void jump_to_eax()
+    {
+        bytes({0x89, 0xC0});
+        bytes({0x41, 0xFF, 0x24, 0xC7});
+    }
+    // Jumps forward within the code of one op, to where land() is called with the returned position.
+    std::size_t short_jump(std::uint8_t opcode)
+    {
+        bytes({opcode, 0x00});
+        return code_.size();
+    }
+    void land(std::size_t position)
+    {
+        code_[position - 1] = static_cast<std::uint8_t>(code_.size() - position);
+    }
+    void jump(std::uint32_t target)
+    {
+        bytes({0xE9});
+        fixup(target);
+    }
+    void jump_if(std::uint8_t condition, std::uint32_t target)
+    {
+        bytes({0x0F, condition});
+        fixup(target);
+    }
+    void resolve(std::vector<std::size_t> const& op_offsets)
+    {
+        for (auto const& fixup : fixups_)
+        {
+            const auto relative{static_cast<std::int64_t>(op_offsets[fixup.second]) -
+                                static_cast<std::int64_t>(fixup.first + 4)};
+            const auto value{static_cast<std::uint32_t>(relative)};
+            std::memcpy(code_.data() + fixup.first, &value, sizeof(value));
+        }
+    }
+
+  private:
+    // REX.W prefix widening the next instruction to 64 bits.
+    void word_operand()
+    {
+        if constexpr (sizeof(Word) == sizeof(std::uint64_t))
+        {
+            bytes({0x48});
+        }
+    }
+    void fixup(std::uint32_t target)
+    {
+        fixups_.emplace_back(code_.size(), target);
+        imm32(0);
+    }
+
+    std::vector<std::uint8_t> code_{};
+    std::vector<std::pair<std::size_t, std::uint32_t>> fixups_{};
+};
+
+enum Condition : std::uint8_t
+{
+    IfEqual = 0x84,
+    IfNotEqual = 0x85,
+    IfLess = 0x8C,
+    IfGreaterOrEqual = 0x8D,
+    IfLessOrEqual = 0x8E,
+    IfGreater = 0x8F
+};
+
+unsigned int flag_of(OpCode jump)
+{
+    switch (jump)
+    {
+        case OpCode::Jne:
+            return NotEqual;
+        case OpCode::Je:
+            return Equal;
+        case OpCode::Jge:
+            return GreaterOrEqual;
+        case OpCode::Jg:
+            return Greater;
+        case OpCode::Jle:
+            return LessOrEqual;
+        default:
+            return Less;
+    }
+}
+
+Condition condition_of(OpCode compare_jump)
+{
+    switch (compare_jump)
+    {
+        case OpCode::CmpJne:
+            return IfNotEqual;
+        case OpCode::CmpJe:
+            return IfEqual;
+        case OpCode::CmpJge:
+            return IfGreaterOrEqual;
+        case OpCode::CmpJg:
+            return IfGreater;
+        case OpCode::CmpJle:
+            return IfLessOrEqual;
+        default:
+            return IfLess;
+    }
+}
+
+template <typename Function>
+void const* address_of(Function function)
+{
+    return reinterpret_cast<void const*>(function);
+}
+
+// Emits the ops of a bytecode, returns false for ops it does not know.
+template <typename Word>
+bool emit_program(Bytecode const& bytecode, Assembler<Word>& assembler, std::vector<std::size_t>& op_offsets)
+{
+    using Runtime = JitRuntime<Word>;
+
+    auto const& code{bytecode.code};
+    const auto end{static_cast<std::uint32_t>(code.size())};
+
+    // push rbx, r12..r15; move the arguments into their pinned registers
+    assembler.bytes({0x53, 0x41, 0x54, 0x41, 0x55, 0x41, 0x56, 0x41, 0x57});
+    assembler.bytes({0x48, 0x89, 0xFB, 0x49, 0x89, 0xF4, 0x49, 0x89, 0xD5, 0x49, 0x89, 0xCF, 0x45, 0x89, 0xC6});
+
+    for (std::uint32_t index{0}; index < end; ++index)
+    {
+        auto const& op{code[index]};
+        op_offsets.push_back(assembler.size());
+        switch (op.code)
+        {
+            case OpCode::Mov:
+                assembler.load_eax(op.b);
+                assembler.store_eax(op.a);
+                assembler.mark_touched(op.a);
+                break;
+            case OpCode::Inc:
+                assembler.slot(0xFF, 0x83, op.a);
+                assembler.mark_touched(op.a);
+                break;
+            case OpCode::Dec:
+                assembler.slot(0xFF, 0x8B, op.a);
+                assembler.mark_touched(op.a);
+                break;
+            case OpCode::Add:
+                assembler.load_eax(op.b);
+                assembler.slot(0x01, 0x83, op.a);
+                assembler.mark_touched(op.a);
+                break;
+            case OpCode::Sub:
+                assembler.load_eax(op.b);
+                assembler.slot(0x29, 0x83, op.a);
+                assembler.mark_touched(op.a);
+                break;
+            case OpCode::Mul:
+                assembler.load_eax(op.a);
+                assembler.multiply_eax(op.b);
+                assembler.store_eax(op.a);
+                assembler.mark_touched(op.a);
+                break;
+            case OpCode::Div:
+            {
+                // cmp [divisor], -1; jne divide; neg [dividend]; jmp done
+                assembler.slot(0x83, 0xBB, op.b);
+                assembler.bytes({0xFF});
+                const auto divide{assembler.short_jump(0x75)};
+                assembler.slot(0xF7, 0x9B, op.a);
+                const auto done{assembler.short_jump(0xEB)};
+                assembler.land(divide);
+                assembler.load_eax(op.a);
+                assembler.sign_extend_eax();
+                assembler.slot(0xF7, 0xBB, op.b);
+                assembler.store_eax(op.a);
+                assembler.land(done);
+                assembler.mark_touched(op.a);
+                break;
+            }
+            case OpCode::Jmp:
+                assembler.jump(op.a);
+                break;
+            case OpCode::Jnz:
+                assembler.slot(0x83, 0xBB, op.b);
+                assembler.bytes({0x00});
+                assembler.jump_if(IfNotEqual, op.a);
+                break;
+            case OpCode::JnzDynamic:
+                assembler.slot(0x83, 0xBB, op.b);
+                assembler.bytes({0x00});
+                assembler.jump_if(IfEqual, index + 1);
+                assembler.slot(0x8B, 0x93, op.c);
+                assembler.call_with_index(address_of(&Runtime::relative_jump), op.a);
+                assembler.jump_to_eax();
+                break;
+            case OpCode::Cmp:
+                assembler.compare(op.a, op.b);
+                break;
+            case OpCode::Jne:
+            case OpCode::Je:
+            case OpCode::Jge:
+            case OpCode::Jg:
+            case OpCode::Jle:
+            case OpCode::Jl:
+                assembler.bytes({0x41, 0xF7, 0xC6});
+                assembler.imm32(flag_of(op.code));
+                assembler.jump_if(IfNotEqual, op.a);
+                break;
+            case OpCode::Call:
+                assembler.call_with_index(address_of(&Runtime::push_return), index + 1);
+                // test al, al
+                assembler.bytes({0x84, 0xC0});
+                assembler.jump_if(IfEqual, end);
+                assembler.jump(op.a);
+                break;
+            case OpCode::TailCall:
+                assembler.jump(op.a);
+                break;
+            case OpCode::Ret:
+                assembler.bytes({0x4C, 0x89, 0xEF});
+                assembler.call(address_of(&Runtime::pop_return));
+                assembler.jump_to_eax();
+                break;
+            case OpCode::Msg:
+                assembler.call_with_index(address_of(&Runtime::write_message), op.a);
+                // test al, al
+                assembler.bytes({0x84, 0xC0});
+                assembler.jump_if(IfEqual, end);
+                break;
+            case OpCode::End:
+                assembler.bytes({0x4C, 0x89, 0xEF});
+                assembler.call(address_of(&Runtime::end_program));
+                assembler.jump(end);
+                break;
+            case OpCode::CmpJne:
+            case OpCode::CmpJe:
+            case OpCode::CmpJge:
+            case OpCode::CmpJg:
+            case OpCode::CmpJle:
+            case OpCode::CmpJl:
+                assembler.compare(op.a, op.b);
+                assembler.jump_if(condition_of(op.code), op.c);
+                assembler.jump(index + 2);
+                break;
+            case OpCode::DecJnz:
+                assembler.mark_touched(op.a);
+                assembler.slot(0xFF, 0x8B, op.a);
+                assembler.jump_if(IfNotEqual, op.c);
+                assembler.jump(index + 2);
+                break;
+            case OpCode::CountedLoop:
+                // mov edx, r14d; call; mov r14, rax; shr r14, 32
+                assembler.bytes({0x44, 0x89, 0xF2});
+                assembler.call_with_index(address_of(&Runtime::counted_loop), op.a);
+                assembler.bytes({0x49, 0x89, 0xC6, 0x49, 0xC1, 0xEE, 0x20});
+                assembler.jump_to_eax();
+                break;
+            default:
+                return false;
+        }
+    }
+
+    // mov eax, r14d; pop r15..r12, rbx; ret
+    op_offsets.push_back(assembler.size());
+    assembler.bytes({0x44, 0x89, 0xF0, 0x41, 0x5F, 0x41, 0x5E, 0x41, 0x5D, 0x41, 0x5C, 0x5B, 0xC3});
+    assembler.resolve(op_offsets);
+    return true;
+}
+
+template <typename Word>
+std::shared_ptr<JitCode> compile_native(Bytecode const& bytecode)
+{
+    Assembler<Word> assembler{};
+    std::vector<std::size_t> op_offsets{};
+    if (!emit_program(bytecode, assembler, op_offsets))
+    {
+        return nullptr;
+    }
+    auto native{std::make_shared<JitCode>(assembler.code(), op_offsets)};
+    return native->is_valid() ? native : nullptr;
+}
+}  // namespace
+
+template <typename Word>
+void BasicMachine<Word>::run_jit()
+{
+    if (!jit_code_)
+    {
+        jit_code_ = bytecode_->native_code.get(sizeof(Word), [this] { return compile_native<Word>(*bytecode_); });
+    }
+    if (!jit_code_)
+    {
+        run_threaded();
+        return;
+    }
+    return_stack_.clear();
+    comparison_.set_flags(jit_code_->run(slots_.data(), touched_slots_.data(), this, comparison_.flags()));
+    if (jit_exception_)
+    {
+        std::rethrow_exception(std::exchange(jit_exception_, nullptr));
+    }
+}
+
+#else
+
+template <typename Word>
+void BasicMachine<Word>::run_jit()
+{
+    run_threaded();
+}
+
+#endif
+
+template void BasicMachine<std::int32_t>::run_jit();
+template void BasicMachine<std::int64_t>::run_jit();
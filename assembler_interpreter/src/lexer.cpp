@@ -0,0 +1,69 @@
+#include "assembler_interpreter/src/lexer.h"
+
+#include <cctype>
+
+bool Lexer::is_at_line_end() const
+{
+    return position_ == source_.size() || source_[position_] == '\n';
+}
+
+bool Lexer::is_delimiter() const
+{
+    const auto is_space{[this](std::size_t pos) {
+        return pos < source_.size() && source_[pos] != '\n' && std::isspace(static_cast<unsigned char>(source_[pos]));
+    }};
+    return is_space(position_) || (source_[position_] == ',' && is_space(position_ + 1));
+}
+
+void Lexer::skip_comment()
+{
+    while (!is_at_line_end())
+    {
+        ++position_;
+    }
+}
+
+bool Lexer::next_line(TokenLine& tokens)
+{
+    tokens.clear();
+    while (tokens.empty() && position_ < source_.size())
+    {
+        auto token_begin{Token::npos};
+        bool is_in_quotes{false};
+        const auto finish_token{[&]() {
+            if (token_begin != Token::npos)
+            {
+                tokens.push_back(source_.substr(token_begin, position_ - token_begin));
+                token_begin = Token::npos;
+            }
+        }};
+
+        for (; !is_at_line_end(); ++position_)
+        {
+            const auto c{source_[position_]};
+            if (is_in_quotes)
+            {
+                is_in_quotes = c != '\'';
+            }
+            else if (c == ';')
+            {
+                finish_token();
+                skip_comment();
+                break;
+            }
+            else if (is_delimiter())
+            {
+                finish_token();
+                position_ += (c == ',') ? 1 : 0;
+            }
+            else
+            {
+                is_in_quotes = c == '\'';
+                token_begin = (token_begin == Token::npos) ? position_ : token_begin;
+            }
+        }
+        finish_token();
+        position_ += (position_ < source_.size()) ? 1 : 0;
+    }
+    return !tokens.empty();
+}
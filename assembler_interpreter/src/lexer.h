@@ -0,0 +1,28 @@
+#ifndef LEXER_H
+#define LEXER_H
+
+#include <string_view>
+#include <vector>
+
+using Token = std::string_view;
+using TokenLine = std::vector<Token>;
+
+// Single pass tokenizer over a program buffer. Every emitted token is a view into the buffer.
+// Tokens are separated by whitespace, optionally preceded by a comma. A ';' starts a comment that
+// reaches until the end of the line. Both rules are suspended inside single quoted text.
+class Lexer
+{
+  public:
+    explicit Lexer(std::string_view source) : source_{source} {}
+    bool next_line(TokenLine& tokens);
+
+  private:
+    bool is_at_line_end() const;
+    bool is_delimiter() const;
+    void skip_comment();
+
+    std::string_view source_{};
+    std::size_t position_{0};
+};
+
+#endif /* LEXER_H */
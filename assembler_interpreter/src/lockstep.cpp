@@ -0,0 +1,884 @@
+#include "assembler_interpreter/src/lockstep.h"
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include "assembler_interpreter/src/control_flow.h"
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#define LOCKSTEP_AVX2 1
+#define AVX2_TARGET __attribute__((target("avx2")))
+#endif
+
+// Operations on a row of lanes. A mask holds all ones for each lane an operation applies to and zero for the
+// others, lanes it does not apply to keep their values. A null mask applies it to every lane. test sets taken to
+// all ones for the lanes whose values share a bit with bits and returns how many there are.
+template <typename Word>
+struct LaneKernels
+{
+    using Combine = void (*)(Word* target, Word const* source, Word const* mask, std::size_t lanes);
+
+    Combine move{nullptr};
+    Combine add{nullptr};
+    Combine subtract{nullptr};
+    Combine multiply{nullptr};
+    void (*add_value)(Word* target, Word value, Word const* mask, std::size_t lanes){nullptr};
+    void (*compare)(Word* flags, Word const* lhs, Word const* rhs, Word const* mask, std::size_t lanes){nullptr};
+    std::size_t (*test)(Word* taken, Word const* values, Word bits, Word const* mask, std::size_t lanes){nullptr};
+};
+
+namespace
+{
+enum class LaneOperation
+{
+    Move,
+    Add,
+    Subtract,
+    Multiply
+};
+
+template <typename Word, LaneOperation operation>
+Word combine(Word target, Word source)
+{
+    if constexpr (operation == LaneOperation::Move)
+    {
+        return source;
+    }
+    else if constexpr (operation == LaneOperation::Add)
+    {
+        return wrapping_add(target, source);
+    }
+    else if constexpr (operation == LaneOperation::Subtract)
+    {
+        return wrapping_subtract(target, source);
+    }
+    else
+    {
+        return wrapping_multiply(target, source);
+    }
+}
+
+template <typename Word>
+Word select(Word mask, Word chosen, Word kept)
+{
+    return (chosen & mask) | (kept & ~mask);
+}
+
+template <typename Word>
+Word comparison_flags(Word lhs, Word rhs)
+{
+    constexpr Word equal{Equal | LessOrEqual | GreaterOrEqual};
+    constexpr Word less{NotEqual | Less | LessOrEqual};
+    constexpr Word greater{NotEqual | Greater | GreaterOrEqual};
+    return (lhs == rhs) ? equal : ((lhs < rhs) ? less : greater);
+}
+
+// The portable kernels are plain loops, which the compiler vectorizes for whatever the target guarantees.
+template <typename Word, LaneOperation operation>
+void combine_lanes(Word* target, Word const* source, Word const* mask, std::size_t lanes)
+{
+    if (mask == nullptr)
+    {
+        for (std::size_t lane{0}; lane < lanes; ++lane)
+        {
+            target[lane] = combine<Word, operation>(target[lane], source[lane]);
+        }
+        return;
+    }
+    for (std::size_t lane{0}; lane < lanes; ++lane)
+    {
+        target[lane] = select(mask[lane], combine<Word, operation>(target[lane], source[lane]), target[lane]);
+    }
+}
+
+template <typename Word>
+void add_value_to_lanes(Word* target, Word value, Word const* mask, std::size_t lanes)
+{
+    if (mask == nullptr)
+    {
+        for (std::size_t lane{0}; lane < lanes; ++lane)
+        {
+            target[lane] = combine<Word, LaneOperation::Add>(target[lane], value);
+        }
+        return;
+    }
+    for (std::size_t lane{0}; lane < lanes; ++lane)
+    {
+        target[lane] = select(mask[lane], combine<Word, LaneOperation::Add>(target[lane], value), target[lane]);
+    }
+}
+
+template <typename Word>
+void compare_lanes(Word* flags, Word const* lhs, Word const* rhs, Word const* mask, std::size_t lanes)
+{
+    if (mask == nullptr)
+    {
+        for (std::size_t lane{0}; lane < lanes; ++lane)
+        {
+            flags[lane] = comparison_flags(lhs[lane], rhs[lane]);
+        }
+        return;
+    }
+    for (std::size_t lane{0}; lane < lanes; ++lane)
+    {
+        flags[lane] = select(mask[lane], comparison_flags(lhs[lane], rhs[lane]), flags[lane]);
+    }
+}
+
+template <typename Word>
+std::size_t test_lanes(Word* taken, Word const* values, Word bits, Word const* mask, std::size_t lanes)
+{
+    std::size_t count{0};
+    for (std::size_t lane{0}; lane < lanes; ++lane)
+    {
+        const Word hit{((values[lane] & bits) != 0) ? Word{-1} : Word{0}};
+        taken[lane] = (mask == nullptr) ? hit : (hit & mask[lane]);
+        count += static_cast<std::size_t>(taken[lane] & 1);
+    }
+    return count;
+}
+
+template <typename Word>
+LaneKernels<Word> portable_kernels()
+{
+    LaneKernels<Word> kernels{};
+    kernels.move = combine_lanes<Word, LaneOperation::Move>;
+    kernels.add = combine_lanes<Word, LaneOperation::Add>;
+    kernels.subtract = combine_lanes<Word, LaneOperation::Subtract>;
+    kernels.multiply = combine_lanes<Word, LaneOperation::Multiply>;
+    kernels.add_value = add_value_to_lanes<Word>;
+    kernels.compare = compare_lanes<Word>;
+    kernels.test = test_lanes<Word>;
+    return kernels;
+}
+
+#if defined(LOCKSTEP_AVX2)
+// AVX2 operations on as many lanes as fit a 256 bit register. There is no 64 bit multiply, 64 bit lanes multiply
+// through the portable kernel.
+template <typename Word>
+struct Avx2Lanes;
+
+template <>
+struct Avx2Lanes<std::int32_t>
+{
+    static constexpr std::size_t width{8};
+
+    AVX2_TARGET static __m256i broadcast(std::int32_t value)
+    {
+        return _mm256_set1_epi32(value);
+    }
+    AVX2_TARGET static __m256i add(__m256i lhs, __m256i rhs)
+    {
+        return _mm256_add_epi32(lhs, rhs);
+    }
+    AVX2_TARGET static __m256i subtract(__m256i lhs, __m256i rhs)
+    {
+        return _mm256_sub_epi32(lhs, rhs);
+    }
+    AVX2_TARGET static __m256i multiply(__m256i lhs, __m256i rhs)
+    {
+        return _mm256_mullo_epi32(lhs, rhs);
+    }
+    AVX2_TARGET static __m256i equal(__m256i lhs, __m256i rhs)
+    {
+        return _mm256_cmpeq_epi32(lhs, rhs);
+    }
+    AVX2_TARGET static __m256i greater(__m256i lhs, __m256i rhs)
+    {
+        return _mm256_cmpgt_epi32(lhs, rhs);
+    }
+    AVX2_TARGET static std::size_t count(__m256i mask)
+    {
+        return static_cast<std::size_t>(__builtin_popcount(_mm256_movemask_ps(_mm256_castsi256_ps(mask))));
+    }
+};
+
+template <>
+struct Avx2Lanes<std::int64_t>
+{
+    static constexpr std::size_t width{4};
+
+    AVX2_TARGET static __m256i broadcast(std::int64_t value)
+    {
+        return _mm256_set1_epi64x(value);
+    }
+    AVX2_TARGET static __m256i add(__m256i lhs, __m256i rhs)
+    {
+        return _mm256_add_epi64(lhs, rhs);
+    }
+    AVX2_TARGET static __m256i subtract(__m256i lhs, __m256i rhs)
+    {
+        return _mm256_sub_epi64(lhs, rhs);
+    }
+    AVX2_TARGET static __m256i equal(__m256i lhs, __m256i rhs)
+    {
+        return _mm256_cmpeq_epi64(lhs, rhs);
+    }
+    AVX2_TARGET static __m256i greater(__m256i lhs, __m256i rhs)
+    {
+        return _mm256_cmpgt_epi64(lhs, rhs);
+    }
+    AVX2_TARGET static std::size_t count(__m256i mask)
+    {
+        return static_cast<std::size_t>(__builtin_popcount(_mm256_movemask_pd(_mm256_castsi256_pd(mask))));
+    }
+};
+
+template <typename Word>
+AVX2_TARGET __m256i load_lanes(Word const* lanes)
+{
+    return _mm256_loadu_si256(reinterpret_cast<__m256i const*>(lanes));
+}
+
+template <typename Word>
+AVX2_TARGET void store_lanes(Word* lanes, __m256i values)
+{
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes), values);
+}
+
+// Keeps the lanes of kept the mask leaves out, masks select whole lanes so a byte blend does.
+template <typename Word>
+AVX2_TARGET __m256i select_lanes(Word const* mask, __m256i chosen, __m256i kept)
+{
+    return (mask == nullptr) ? chosen : _mm256_blendv_epi8(kept, chosen, load_lanes(mask));
+}
+
+template <typename Word>
+Word const* remaining_mask(Word const* mask, std::size_t lane)
+{
+    return (mask == nullptr) ? nullptr : mask + lane;
+}
+
+template <typename Word, LaneOperation operation>
+AVX2_TARGET __m256i combine_vectors(__m256i target, __m256i source)
+{
+    using Lanes = Avx2Lanes<Word>;
+    if constexpr (operation == LaneOperation::Move)
+    {
+        return source;
+    }
+    else if constexpr (operation == LaneOperation::Add)
+    {
+        return Lanes::add(target, source);
+    }
+    else if constexpr (operation == LaneOperation::Subtract)
+    {
+        return Lanes::subtract(target, source);
+    }
+    else
+    {
+        return Lanes::multiply(target, source);
+    }
+}
+
+// Lanes behind the last full register go through the portable kernel.
+template <typename Word, LaneOperation operation>
+AVX2_TARGET void combine_lanes_avx2(Word* target, Word const* source, Word const* mask, std::size_t lanes)
+{
+    std::size_t lane{0};
+    for (; lane + Avx2Lanes<Word>::width <= lanes; lane += Avx2Lanes<Word>::width)
+    {
+        const auto kept{load_lanes(target + lane)};
+        const auto combined{combine_vectors<Word, operation>(kept, load_lanes(source + lane))};
+        store_lanes(target + lane, select_lanes(remaining_mask(mask, lane), combined, kept));
+    }
+    combine_lanes<Word, operation>(target + lane, source + lane, remaining_mask(mask, lane), lanes - lane);
+}
+
+template <typename Word>
+AVX2_TARGET void add_value_to_lanes_avx2(Word* target, Word value, Word const* mask, std::size_t lanes)
+{
+    const auto values{Avx2Lanes<Word>::broadcast(value)};
+    std::size_t lane{0};
+    for (; lane + Avx2Lanes<Word>::width <= lanes; lane += Avx2Lanes<Word>::width)
+    {
+        const auto kept{load_lanes(target + lane)};
+        store_lanes(target + lane, select_lanes(remaining_mask(mask, lane), Avx2Lanes<Word>::add(kept, values), kept));
+    }
+    add_value_to_lanes(target + lane, value, remaining_mask(mask, lane), lanes - lane);
+}
+
+template <typename Word>
+AVX2_TARGET void compare_lanes_avx2(Word* flags, Word const* lhs, Word const* rhs, Word const* mask,
+                                    std::size_t lanes)
+{
+    using Lanes = Avx2Lanes<Word>;
+    const auto equal_flags{Lanes::broadcast(Equal | LessOrEqual | GreaterOrEqual)};
+    const auto less_flags{Lanes::broadcast(NotEqual | Less | LessOrEqual)};
+    const auto greater_flags{Lanes::broadcast(NotEqual | Greater | GreaterOrEqual)};
+    std::size_t lane{0};
+    for (; lane + Lanes::width <= lanes; lane += Lanes::width)
+    {
+        const auto left{load_lanes(lhs + lane)};
+        const auto right{load_lanes(rhs + lane)};
+        const auto equal{_mm256_and_si256(Lanes::equal(left, right), equal_flags)};
+        const auto less{_mm256_and_si256(Lanes::greater(right, left), less_flags)};
+        const auto greater{_mm256_and_si256(Lanes::greater(left, right), greater_flags)};
+        const auto compared{_mm256_or_si256(equal, _mm256_or_si256(less, greater))};
+        store_lanes(flags + lane, select_lanes(remaining_mask(mask, lane), compared, load_lanes(flags + lane)));
+    }
+    compare_lanes(flags + lane, lhs + lane, rhs + lane, remaining_mask(mask, lane), lanes - lane);
+}
+
+template <typename Word>
+AVX2_TARGET std::size_t test_lanes_avx2(Word* taken, Word const* values, Word bits, Word const* mask,
+                                        std::size_t lanes)
+{
+    using Lanes = Avx2Lanes<Word>;
+    const auto tested{Lanes::broadcast(bits)};
+    const auto zero{_mm256_setzero_si256()};
+    std::size_t count{0};
+    std::size_t lane{0};
+    for (; lane + Lanes::width <= lanes; lane += Lanes::width)
+    {
+        const auto missed{Lanes::equal(_mm256_and_si256(load_lanes(values + lane), tested), zero)};
+        const auto all_lanes{(mask == nullptr) ? _mm256_cmpeq_epi32(zero, zero) : load_lanes(mask + lane)};
+        const auto hit{_mm256_andnot_si256(missed, all_lanes)};
+        store_lanes(taken + lane, hit);
+        count += Lanes::count(hit);
+    }
+    return count + test_lanes(taken + lane, values + lane, bits, remaining_mask(mask, lane), lanes - lane);
+}
+
+template <typename Word>
+LaneKernels<Word> avx2_kernels()
+{
+    auto kernels{portable_kernels<Word>()};
+    kernels.move = combine_lanes_avx2<Word, LaneOperation::Move>;
+    kernels.add = combine_lanes_avx2<Word, LaneOperation::Add>;
+    kernels.subtract = combine_lanes_avx2<Word, LaneOperation::Subtract>;
+    if constexpr (sizeof(Word) == sizeof(std::int32_t))
+    {
+        kernels.multiply = combine_lanes_avx2<Word, LaneOperation::Multiply>;
+    }
+    kernels.add_value = add_value_to_lanes_avx2<Word>;
+    kernels.compare = compare_lanes_avx2<Word>;
+    kernels.test = test_lanes_avx2<Word>;
+    return kernels;
+}
+#endif
+
+template <typename Word>
+LaneKernels<Word> const* lane_kernels(bool simd)
+{
+    static const auto portable{portable_kernels<Word>()};
+#if defined(LOCKSTEP_AVX2)
+    static const auto avx2{avx2_kernels<Word>()};
+    if (simd && __builtin_cpu_supports("avx2"))
+    {
+        return &avx2;
+    }
+#endif
+    return &portable;
+}
+
+CmpStatusFlags flag_of(OpCode jump)
+{
+    switch (jump)
+    {
+        case OpCode::Jne:
+        case OpCode::CmpJne:
+            return NotEqual;
+        case OpCode::Je:
+        case OpCode::CmpJe:
+            return Equal;
+        case OpCode::Jge:
+        case OpCode::CmpJge:
+            return GreaterOrEqual;
+        case OpCode::Jg:
+        case OpCode::CmpJg:
+            return Greater;
+        case OpCode::Jle:
+        case OpCode::CmpJle:
+            return LessOrEqual;
+        case OpCode::Jl:
+        case OpCode::CmpJl:
+            return Less;
+        default:
+            return Invalid;
+    }
+}
+}  // namespace
+
+template <typename Word>
+BasicLockstepMachine<Word>::BasicLockstepMachine(std::size_t lanes)
+    : lanes_{lanes},
+      kernels_{lane_kernels<Word>(true)},
+      flags_(lanes),
+      group_(lanes),
+      taken_(lanes),
+      ips_(lanes),
+      running_(lanes),
+      statuses_(lanes, RunStatus::Finished),
+      outputs_(lanes),
+      return_stacks_(lanes)
+{
+}
+
+template <typename Word>
+std::size_t BasicLockstepMachine<Word>::lanes() const
+{
+    return lanes_;
+}
+
+template <typename Word>
+void BasicLockstepMachine<Word>::load_program(std::string_view source)
+{
+    BasicMachine<Word> machine{};
+    machine.load_program(source);
+    load_program(machine.compiled_program());
+}
+
+// Programs holding values a Word cannot represent throw std::out_of_range and leave the machine as it was.
+template <typename Word>
+void BasicLockstepMachine<Word>::load_program(CompiledProgram program)
+{
+    auto const& values{program->initial_slot_values};
+    const auto fits{[](SlotValue value) {
+        return value >= std::numeric_limits<Word>::min() && value <= std::numeric_limits<Word>::max();
+    }};
+    if (!std::all_of(values.begin(), values.end(), fits))
+    {
+        throw std::out_of_range{"Program values do not fit the machine word"};
+    }
+    const ControlFlowGraph graph{*program};
+    block_starts_.assign(program->code.size(), 0);
+    for (auto const& block : graph.blocks())
+    {
+        block_starts_[block.begin] = 1;
+    }
+    bytecode_ = std::move(program);
+    seeded_registers_.clear();
+}
+
+template <typename Word>
+CompiledProgram BasicLockstepMachine<Word>::compiled_program() const
+{
+    return bytecode_;
+}
+
+template <typename Word>
+void BasicLockstepMachine<Word>::set_register(std::string const& name, std::vector<Word> const& values)
+{
+    auto const& names{bytecode_->slot_names};
+    const auto slot{name.empty() ? names.end() : std::find(names.begin(), names.end(), name)};
+    if (slot == names.end())
+    {
+        throw std::out_of_range{"Unknown register " + name};
+    }
+    if (values.size() != lanes_)
+    {
+        throw std::invalid_argument{"Register " + name + " needs one value per lane"};
+    }
+    seeded_registers_.emplace_back(static_cast<Slot>(slot - names.begin()), values);
+}
+
+template <typename Word>
+void BasicLockstepMachine<Word>::set_max_call_depth(std::size_t depth)
+{
+    max_call_depth_ = depth;
+}
+
+template <typename Word>
+void BasicLockstepMachine<Word>::set_simd(bool enabled)
+{
+    kernels_ = lane_kernels<Word>(enabled);
+}
+
+template <typename Word>
+void BasicLockstepMachine<Word>::reset()
+{
+    seeded_registers_.clear();
+    reset_execution();
+}
+
+template <typename Word>
+void BasicLockstepMachine<Word>::reset_execution()
+{
+    auto const& values{bytecode_->initial_slot_values};
+    slots_.resize(values.size() * lanes_);
+    for (Slot slot{0}; slot < values.size(); ++slot)
+    {
+        std::fill_n(row(slot), lanes_, static_cast<Word>(values[slot]));
+    }
+    touched_slots_.assign(slots_.size(), 0);
+    for (auto const& seed : seeded_registers_)
+    {
+        std::copy(seed.second.begin(), seed.second.end(), row(seed.first));
+        std::fill_n(touched_slots_.begin() + seed.first * lanes_, lanes_, 1);
+    }
+    std::fill(flags_.begin(), flags_.end(), Word{Invalid});
+    std::fill(ips_.begin(), ips_.end(), 0);
+    std::fill(running_.begin(), running_.end(), 1);
+    std::fill(statuses_.begin(), statuses_.end(), RunStatus::Finished);
+    for (std::size_t lane{0}; lane < lanes_; ++lane)
+    {
+        outputs_[lane].clear();
+        return_stacks_[lane].clear();
+    }
+    running_lanes_ = lanes_;
+}
+
+template <typename Word>
+void BasicLockstepMachine<Word>::run_program()
+{
+    reset_execution();
+    auto const& code{bytecode_->code};
+    const auto end{static_cast<std::uint32_t>(code.size())};
+    select_group();
+    while (group_size_ != 0)
+    {
+        if (pc_ < end)
+        {
+            execute(code[pc_]);
+            continue;
+        }
+        for (std::size_t lane{0}; lane < lanes_; ++lane)
+        {
+            if (group_[lane])
+            {
+                leave(lane, RunStatus::Finished);
+            }
+        }
+        select_group();
+    }
+}
+
+template <typename Word>
+RunStatus BasicLockstepMachine<Word>::status(std::size_t lane) const
+{
+    return statuses_[lane];
+}
+
+template <typename Word>
+BasicRegisters<Word> BasicLockstepMachine<Word>::get_registers(std::size_t lane) const
+{
+    BasicRegisters<Word> registers{};
+    auto const& names{bytecode_->slot_names};
+    for (Slot slot{0}; slot < names.size(); ++slot)
+    {
+        const auto index{slot * lanes_ + lane};
+        if (touched_slots_[index])
+        {
+            registers.emplace(names[slot], slots_[index]);
+        }
+    }
+    return registers;
+}
+
+// Like Machine::flush, the output of the lane is handed out without copying it.
+template <typename Word>
+std::string const& BasicLockstepMachine<Word>::flush(std::size_t lane) const
+{
+    static const std::string unended{"-1"};
+    return (statuses_[lane] == RunStatus::Ended) ? outputs_[lane] : unended;
+}
+
+template <typename Word>
+Word* BasicLockstepMachine<Word>::row(Slot slot)
+{
+    return slots_.data() + slot * lanes_;
+}
+
+template <typename Word>
+Word const* BasicLockstepMachine<Word>::group_mask() const
+{
+    return (group_size_ == lanes_) ? nullptr : group_.data();
+}
+
+// Gathers the running lanes at the lowest instruction pointer into the group. Lanes behind the others catch up
+// first, so lanes on different paths meet again at the first op both paths run.
+template <typename Word>
+void BasicLockstepMachine<Word>::select_group()
+{
+    pc_ = std::numeric_limits<std::uint32_t>::max();
+    for (std::size_t lane{0}; lane < lanes_; ++lane)
+    {
+        if (running_[lane])
+        {
+            pc_ = std::min(pc_, ips_[lane]);
+        }
+    }
+    group_size_ = 0;
+    for (std::size_t lane{0}; lane < lanes_; ++lane)
+    {
+        const bool selected{running_[lane] && ips_[lane] == pc_};
+        group_[lane] = selected ? Word{-1} : Word{0};
+        group_size_ += selected;
+    }
+}
+
+// Waiting lanes can only be at the start of a block, the group looks for them whenever it enters one.
+template <typename Word>
+void BasicLockstepMachine<Word>::advance(std::uint32_t next)
+{
+    pc_ = next;
+    if (group_size_ == running_lanes_ || next >= block_starts_.size() || !block_starts_[next])
+    {
+        return;
+    }
+    for (std::size_t lane{0}; lane < lanes_; ++lane)
+    {
+        if (group_[lane])
+        {
+            ips_[lane] = next;
+        }
+    }
+    select_group();
+}
+
+template <typename Word>
+void BasicLockstepMachine<Word>::branch(std::uint32_t target, std::uint32_t fall_through, std::size_t taken)
+{
+    if (taken == group_size_)
+    {
+        advance(target);
+        return;
+    }
+    if (taken == 0)
+    {
+        advance(fall_through);
+        return;
+    }
+    for (std::size_t lane{0}; lane < lanes_; ++lane)
+    {
+        if (group_[lane])
+        {
+            ips_[lane] = taken_[lane] ? target : fall_through;
+        }
+    }
+    select_group();
+}
+
+template <typename Word>
+void BasicLockstepMachine<Word>::leave(std::size_t lane, RunStatus status)
+{
+    running_[lane] = 0;
+    statuses_[lane] = status;
+    group_[lane] = 0;
+    --group_size_;
+    --running_lanes_;
+}
+
+template <typename Word>
+void BasicLockstepMachine<Word>::touch(Slot slot)
+{
+    auto* const touched{touched_slots_.data() + slot * lanes_};
+    Word const* const mask{group_mask()};
+    if (mask == nullptr)
+    {
+        std::fill_n(touched, lanes_, 1);
+        return;
+    }
+    for (std::size_t lane{0}; lane < lanes_; ++lane)
+    {
+        touched[lane] |= static_cast<std::uint8_t>(mask[lane] & 1);
+    }
+}
+
+template <typename Word>
+void BasicLockstepMachine<Word>::execute(Op const& op)
+{
+    Word const* const mask{group_mask()};
+    switch (op.code)
+    {
+        case OpCode::Mov:
+            kernels_->move(row(op.a), row(op.b), mask, lanes_);
+            touch(op.a);
+            advance(pc_ + 1);
+            break;
+        case OpCode::Inc:
+            kernels_->add_value(row(op.a), 1, mask, lanes_);
+            touch(op.a);
+            advance(pc_ + 1);
+            break;
+        case OpCode::Dec:
+            kernels_->add_value(row(op.a), -1, mask, lanes_);
+            touch(op.a);
+            advance(pc_ + 1);
+            break;
+        case OpCode::Add:
+            kernels_->add(row(op.a), row(op.b), mask, lanes_);
+            touch(op.a);
+            advance(pc_ + 1);
+            break;
+        case OpCode::Sub:
+            kernels_->subtract(row(op.a), row(op.b), mask, lanes_);
+            touch(op.a);
+            advance(pc_ + 1);
+            break;
+        case OpCode::Mul:
+            kernels_->multiply(row(op.a), row(op.b), mask, lanes_);
+            touch(op.a);
+            advance(pc_ + 1);
+            break;
+        case OpCode::Div:
+            divide(op.a, op.b);
+            advance(pc_ + 1);
+            break;
+        case OpCode::Jmp:
+        case OpCode::TailCall:
+            advance(op.a);
+            break;
+        case OpCode::Jnz:
+            branch(op.a, pc_ + 1, kernels_->test(taken_.data(), row(op.b), Word{-1}, mask, lanes_));
+            break;
+        case OpCode::JnzDynamic:
+            jump_dynamic(op);
+            break;
+        case OpCode::Cmp:
+            kernels_->compare(flags_.data(), row(op.a), row(op.b), mask, lanes_);
+            advance(pc_ + 1);
+            break;
+        case OpCode::Jne:
+        case OpCode::Je:
+        case OpCode::Jge:
+        case OpCode::Jg:
+        case OpCode::Jle:
+        case OpCode::Jl:
+            branch(op.a, pc_ + 1, kernels_->test(taken_.data(), flags_.data(), flag_of(op.code), mask, lanes_));
+            break;
+        case OpCode::Call:
+            call(op.a);
+            break;
+        case OpCode::Ret:
+            return_from_call();
+            break;
+        case OpCode::Msg:
+            write_message(bytecode_->messages[op.a]);
+            advance(pc_ + 1);
+            break;
+        case OpCode::End:
+            for (std::size_t lane{0}; lane < lanes_; ++lane)
+            {
+                if (group_[lane])
+                {
+                    leave(lane, RunStatus::Ended);
+                }
+            }
+            select_group();
+            break;
+        case OpCode::CmpJne:
+        case OpCode::CmpJe:
+        case OpCode::CmpJge:
+        case OpCode::CmpJg:
+        case OpCode::CmpJle:
+        case OpCode::CmpJl:
+            kernels_->compare(flags_.data(), row(op.a), row(op.b), mask, lanes_);
+            branch(op.c, pc_ + 2, kernels_->test(taken_.data(), flags_.data(), flag_of(op.code), mask, lanes_));
+            break;
+        case OpCode::DecJnz:
+            kernels_->add_value(row(op.a), -1, mask, lanes_);
+            touch(op.a);
+            branch(op.c, pc_ + 2, kernels_->test(taken_.data(), row(op.a), Word{-1}, mask, lanes_));
+            break;
+        case OpCode::CountedLoop:
+            // The replaced branch sits where the loop op does, so it continues at the head or the exit.
+            execute(bytecode_->loops[op.a].backedge);
+            break;
+    }
+}
+
+template <typename Word>
+void BasicLockstepMachine<Word>::call(std::uint32_t callee)
+{
+    for (std::size_t lane{0}; lane < lanes_; ++lane)
+    {
+        if (!group_[lane])
+        {
+            continue;
+        }
+        auto& return_stack{return_stacks_[lane]};
+        if (max_call_depth_ != 0 && return_stack.size() == max_call_depth_)
+        {
+            leave(lane, RunStatus::CallDepthLimit);
+            continue;
+        }
+        return_stack.push_back(pc_ + 1);
+    }
+    if (group_size_ == 0)
+    {
+        select_group();
+        return;
+    }
+    advance(callee);
+}
+
+// Divides lane by lane, lanes outside the group must not trap on their divisors.
+template <typename Word>
+void BasicLockstepMachine<Word>::divide(Slot dividend, Slot divisor)
+{
+    Word* const dividends{row(dividend)};
+    Word const* const divisors{row(divisor)};
+    for (std::size_t lane{0}; lane < lanes_; ++lane)
+    {
+        if (group_[lane])
+        {
+            dividends[lane] = wrapping_divide(dividends[lane], divisors[lane]);
+        }
+    }
+    touch(dividend);
+}
+
+template <typename Word>
+void BasicLockstepMachine<Word>::jump_dynamic(Op const& op)
+{
+    Word const* const conditions{row(op.b)};
+    Word const* const distances{row(op.c)};
+    for (std::size_t lane{0}; lane < lanes_; ++lane)
+    {
+        if (group_[lane])
+        {
+            ips_[lane] = (conditions[lane] != 0) ? bytecode_->relative_jump_target(op.a, distances[lane]) : pc_ + 1;
+        }
+    }
+    select_group();
+}
+
+template <typename Word>
+void BasicLockstepMachine<Word>::return_from_call()
+{
+    for (std::size_t lane{0}; lane < lanes_; ++lane)
+    {
+        if (!group_[lane])
+        {
+            continue;
+        }
+        auto& return_stack{return_stacks_[lane]};
+        if (return_stack.empty())
+        {
+            leave(lane, RunStatus::Finished);
+            continue;
+        }
+        ips_[lane] = return_stack.back();
+        return_stack.pop_back();
+    }
+    select_group();
+}
+
+// Gathers the values the message prints for each lane into a slot array of their own, so lanes render exactly
+// what the other machines do.
+template <typename Word>
+void BasicLockstepMachine<Word>::write_message(MessageTemplate const& message)
+{
+    message_slots_.resize(bytecode_->slot_count());
+    for (std::size_t lane{0}; lane < lanes_; ++lane)
+    {
+        if (!group_[lane])
+        {
+            continue;
+        }
+        for (auto const& segment : message.segments())
+        {
+            if (segment.has_value)
+            {
+                message_slots_[segment.slot] = row(segment.slot)[lane];
+            }
+        }
+        message.render(outputs_[lane], message_slots_.data());
+    }
+}
+
+template class BasicLockstepMachine<std::int32_t>;
+template class BasicLockstepMachine<std::int64_t>;
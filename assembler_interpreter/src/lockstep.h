@@ -0,0 +1,90 @@
+#ifndef LOCKSTEP_H
+#define LOCKSTEP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "assembler_interpreter/src/bytecode.h"
+#include "assembler_interpreter/src/execution_limits.h"
+#include "assembler_interpreter/src/machine.h"
+
+template <typename Word>
+struct LaneKernels;
+
+// Runs one program over many register sets at once, one lane per set. Registers are stored slot by slot, the
+// values of a slot in all lanes next to each other, and every op runs on all lanes that reached it with one pass
+// over those rows, through AVX2 kernels where the host has them. Lanes that branch apart wait while the ones at
+// the lowest instruction pointer go on, and run together again from the first block both paths reach. Every lane
+// ends the way a Machine running the same program from the same registers would, loops are stepped through
+// instead of being counted and only the call depth of ExecutionLimits applies.
+template <typename Word>
+class BasicLockstepMachine
+{
+  public:
+    explicit BasicLockstepMachine(std::size_t lanes);
+    std::size_t lanes() const;
+    void load_program(std::string_view source);
+    void load_program(CompiledProgram program);
+    CompiledProgram compiled_program() const;
+    // One value per lane, kept for every later run until reset.
+    void set_register(std::string const& name, std::vector<Word> const& values);
+    void set_max_call_depth(std::size_t depth);
+    // Disabled, the lanes run through portable loops, which compilers vectorize for the baseline instruction set.
+    void set_simd(bool enabled);
+    void reset();
+    void run_program();
+    RunStatus status(std::size_t lane) const;
+    BasicRegisters<Word> get_registers(std::size_t lane) const;
+    std::string const& flush(std::size_t lane) const;
+
+  private:
+    Word* row(Slot slot);
+    Word const* group_mask() const;
+    void reset_execution();
+    void select_group();
+    void advance(std::uint32_t next);
+    void branch(std::uint32_t target, std::uint32_t fall_through, std::size_t taken);
+    void leave(std::size_t lane, RunStatus status);
+    void touch(Slot slot);
+    void execute(Op const& op);
+    void call(std::uint32_t callee);
+    void divide(Slot dividend, Slot divisor);
+    void jump_dynamic(Op const& op);
+    void write_message(MessageTemplate const& message);
+    void return_from_call();
+
+    std::size_t lanes_{0};
+    LaneKernels<Word> const* kernels_{nullptr};
+    CompiledProgram bytecode_{std::make_shared<Bytecode const>()};
+    std::vector<std::uint8_t> block_starts_{};
+    std::vector<std::pair<Slot, std::vector<Word>>> seeded_registers_{};
+    std::size_t max_call_depth_{0};
+
+    // Slot major, the value of slot s in lane l is at s * lanes_ + l.
+    std::vector<Word> slots_{};
+    std::vector<std::uint8_t> touched_slots_{};
+    // Per lane. Flags are the CmpStatusFlags of the last cmp, masks all ones for a lane an op applies to.
+    std::vector<Word> flags_{};
+    std::vector<Word> group_{};
+    std::vector<Word> taken_{};
+    std::vector<std::uint32_t> ips_{};
+    std::vector<std::uint8_t> running_{};
+    std::vector<RunStatus> statuses_{};
+    std::vector<std::string> outputs_{};
+    std::vector<std::vector<std::uint32_t>> return_stacks_{};
+    // Values of one lane in slot order, for the msg of that lane.
+    std::vector<Word> message_slots_{};
+
+    // The group runs the op at pc_, lanes outside it keep their own instruction pointer in ips_.
+    std::uint32_t pc_{0};
+    std::size_t group_size_{0};
+    std::size_t running_lanes_{0};
+};
+
+using LockstepMachine = BasicLockstepMachine<std::int32_t>;
+using LockstepMachine64 = BasicLockstepMachine<std::int64_t>;
+
+#endif /* LOCKSTEP_H */
@@ -0,0 +1,441 @@
+#ifndef MACHINE_H
+#define MACHINE_H
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+#include "assembler_interpreter/src/assembler_main.h"
+#include "assembler_interpreter/src/bytecode.h"
+#include "assembler_interpreter/src/execution_limits.h"
+#include "assembler_interpreter/src/lexer.h"
+#include "assembler_interpreter/src/profiler.h"
+#include "assembler_interpreter/src/trace.h"
+
+using RawProgram = std::vector<std::string>;
+template <typename Word>
+using BasicRegisters = std::unordered_map<std::string, Word>;
+using Registers = BasicRegisters<std::int32_t>;
+template <typename Word>
+class Instruction;
+// Instructions live in an InstructionArena, so owning them only means destroying them.
+struct InstructionDeleter
+{
+    template <typename Word>
+    void operator()(Instruction<Word>* instruction) const
+    {
+        instruction->~Instruction();
+    }
+};
+template <typename Word>
+using Instruction_ptr = std::unique_ptr<Instruction<Word>, InstructionDeleter>;
+template <typename Word>
+using Program = std::vector<Instruction_ptr<Word>>;
+
+template <typename Word>
+class ValueResolver
+{
+  public:
+    ValueResolver(std::vector<Word>* slots) : slots_{slots} {}
+    Word get_value_of(Slot slot) const
+    {
+        return (*slots_)[slot];
+    };
+
+  private:
+    std::vector<Word>* slots_{nullptr};
+};
+
+// Monotonic storage for the instructions of loaded programs, which end up next to each other in program order,
+// and for their operand strings, each stored once.
+class InstructionArena
+{
+  public:
+    template <typename T, typename... Arguments>
+    T* create(Arguments&&... arguments)
+    {
+        return new (resource_.allocate(sizeof(T), alignof(T))) T(std::forward<Arguments>(arguments)...);
+    }
+    std::string_view intern(std::string_view text);
+    std::pmr::memory_resource* resource();
+    void release();
+
+  private:
+    std::pmr::monotonic_buffer_resource resource_{};
+    std::pmr::unordered_set<std::string_view> strings_{&resource_};
+};
+
+template <typename Word>
+class InstructionFactory
+{
+  public:
+    InstructionFactory(std::vector<Word>& slots, InstructionArena& arena);
+    Instruction_ptr<Word> create_instruction(Token name, TokenLine const& arguments);
+
+    template <typename T>
+    Instruction_ptr<Word> make_instruction(TokenLine const& tokens)
+    {
+        auto* new_instruction{arena_->create<T>(tokens, *arena_)};
+        new_instruction->set_resolver(&value_resolver_);
+        return Instruction_ptr<Word>{new_instruction};
+    }
+
+  private:
+    InstructionArena* arena_{nullptr};
+    ValueResolver<Word> value_resolver_;
+};
+
+enum CmpStatusFlags : unsigned int
+{
+    Invalid = 0,
+    Equal = 0b000001,
+    NotEqual = 0b000010,
+    GreaterOrEqual = 0b000100,
+    Greater = 0b001000,
+    LessOrEqual = 0b010000,
+    Less = 0b100000
+};
+
+template <typename Word>
+CmpStatusFlags compare(Word lhs, Word rhs)
+{
+    if (lhs == rhs)
+    {
+        return static_cast<CmpStatusFlags>(Equal | LessOrEqual | GreaterOrEqual);
+    }
+    return static_cast<CmpStatusFlags>(NotEqual | (lhs < rhs ? (Less | LessOrEqual) : (Greater | GreaterOrEqual)));
+}
+
+// Operands of the last cmp. The flag a conditional jump tests is only worked out when the jump runs, a machine
+// that did not compare yet has none of them set.
+template <typename Word>
+class Comparison
+{
+  public:
+    void set(Word lhs, Word rhs)
+    {
+        lhs_ = lhs;
+        rhs_ = rhs;
+        compared_ = true;
+    }
+    bool holds(CmpStatusFlags flag) const
+    {
+        switch (flag)
+        {
+            case Equal:
+                return compared_ && lhs_ == rhs_;
+            case NotEqual:
+                return compared_ && lhs_ != rhs_;
+            case GreaterOrEqual:
+                return compared_ && lhs_ >= rhs_;
+            case Greater:
+                return compared_ && lhs_ > rhs_;
+            case LessOrEqual:
+                return compared_ && lhs_ <= rhs_;
+            case Less:
+                return compared_ && lhs_ < rhs_;
+            default:
+                return false;
+        }
+    }
+    CmpStatusFlags flags() const
+    {
+        return compared_ ? compare(lhs_, rhs_) : Invalid;
+    }
+    // Takes over flags materialized by compare(), through operands comparing the same way.
+    void set_flags(unsigned int flags)
+    {
+        compared_ = flags != Invalid;
+        lhs_ = (flags & Greater) ? 1 : 0;
+        rhs_ = (flags & Less) ? 1 : 0;
+    }
+
+  private:
+    Word lhs_{0};
+    Word rhs_{0};
+    bool compared_{false};
+};
+
+// Bytecode op decoded for direct threading, handler is the address of the code executing it.
+struct ThreadedOp
+{
+    void const* handler{nullptr};
+    std::uint32_t a{0};
+    std::uint32_t b{0};
+    std::uint32_t c{0};
+};
+
+// Return addresses of a run in one contiguous block, kept for later runs. The block starts small and doubles
+// when it fills up, runs with a call depth limit never grow it past that limit and fail to push onto a full stack.
+class ReturnStack
+{
+  public:
+    static constexpr std::size_t initial_capacity{64};
+
+    // Empties the stack for a run of at most max_depth nested calls, zero leaves the depth unbounded.
+    void reset(std::size_t max_depth)
+    {
+        max_depth_ = max_depth;
+        size_ = 0;
+        end_ = (max_depth_ != 0) ? std::min(capacity_, max_depth_) : capacity_;
+    }
+    bool push(std::uint32_t return_address)
+    {
+        if (size_ == end_ && !grow())
+        {
+            return false;
+        }
+        entries_[size_++] = return_address;
+        return true;
+    }
+    std::uint32_t pop()
+    {
+        return entries_[--size_];
+    }
+    bool empty() const
+    {
+        return size_ == 0;
+    }
+    void clear()
+    {
+        size_ = 0;
+    }
+
+  private:
+    bool grow()
+    {
+        if (max_depth_ != 0 && size_ == max_depth_)
+        {
+            return false;
+        }
+        if (size_ == capacity_)
+        {
+            const auto capacity{std::max(initial_capacity, 2 * capacity_)};
+            std::unique_ptr<std::uint32_t[]> entries{new std::uint32_t[capacity]};
+            std::copy(entries_.get(), entries_.get() + size_, entries.get());
+            entries_ = std::move(entries);
+            capacity_ = capacity;
+        }
+        end_ = (max_depth_ != 0) ? std::min(capacity_, max_depth_) : capacity_;
+        return true;
+    }
+
+    std::unique_ptr<std::uint32_t[]> entries_{};
+    std::size_t capacity_{0};
+    std::size_t max_depth_{0};
+    std::size_t end_{0};
+    std::size_t size_{0};
+};
+
+class JitCode;
+template <typename Word>
+struct JitRuntime;
+class OutputSink;
+
+// What dead code elimination may assume about the caller of a run. KeepRegisters keeps every write a later op or
+// the registers a run ends with can show, OutputOnly only the ones the output of later msg can depend on.
+enum class DeadCodeElimination
+{
+    Off,
+    KeepRegisters,
+    OutputOnly
+};
+
+// A loaded program in its compiled form. It is never modified once built, so any number of machines, on any
+// threads, can run it without parsing the source again.
+using CompiledProgram = std::shared_ptr<Bytecode const>;
+
+// Machine computing with registers of type Word, whose arithmetic wraps the way Word does. Each word size gets
+// engines of its own, compiled for it, the ones for std::int32_t and std::int64_t are instantiated.
+template <typename Word>
+class BasicMachine
+{
+  public:
+    BasicRegisters<Word> get_registers() const;
+    Word& get_register(Slot slot);
+    Slot operand_slot(std::string_view operand);
+    Slot register_slot(std::string_view name);
+    std::string const& flush() const;
+    void _return();
+    void add_label_reference(std::string_view name);
+    void advance_ip(std::ptrdiff_t diff);
+    void end_execution();
+    void enter_subroutine(std::size_t position);
+    void jump_if_flag_is_set(std::size_t position, CmpStatusFlags flag);
+    void jump_to(std::size_t position);
+    std::size_t label_position(std::string_view name) const;
+    void compile();
+    CompiledProgram compiled_program() const;
+    std::size_t eliminated_instructions() const;
+    std::uint64_t executed_instructions() const;
+    void load_program(RawProgram const& prog);
+    void load_program(std::string_view source);
+    void load_program(CompiledProgram program);
+    void parse_program(RawProgram const& prog);
+    void parse_program(std::string_view source);
+    void pre_run();
+    Profile const& profile() const;
+    std::size_t program_size() const;
+    void reset();
+    RunStatus run_program();
+    void set_engine(ExecutionEngine engine);
+    void set_execution_limits(ExecutionLimits const& limits);
+    void set_constant_propagation(bool enabled);
+    void set_dead_code_elimination(DeadCodeElimination mode);
+    void set_loop_collapsing(bool enabled);
+    void set_output_sink(OutputSink* sink);
+    void set_profiling(bool enabled);
+    void set_trace_buffer(TraceBuffer* trace);
+    void set_comparison(Word lhs, Word rhs);
+    void set_register(std::string const& name, Word value);
+    void write_message(MessageTemplate const& message);
+
+  private:
+    friend struct JitRuntime<Word>;
+    using ProgramPtr = typename Program<Word>::iterator;
+
+    static constexpr std::size_t sink_chunk_size{4096};
+
+    static SlotTable empty_slot_table();
+    void find_source_blocks(Bytecode const& bytecode);
+    void finish_output();
+    void load_instruction(TokenLine const& tokens, TokenLine& arguments);
+    void reset_execution();
+    void run_bytecode();
+    template <typename Hooks>
+    void run_bytecode(Hooks& hooks);
+    void run_jit();
+    void run_limited();
+    void run_profiled();
+    void run_traced();
+    std::uint32_t run_counted_loop(std::uint32_t loop);
+    void run_reference();
+    void run_threaded();
+    template <typename Hooks>
+    void run_within_limits(Hooks& hooks);
+    void write_message(std::uint32_t message);
+
+    Comparison<Word> comparison_{};
+    Instruction<Word>& get_current_instruction() const;
+    InstructionArena arena_{};
+    InstructionFactory<Word> instruction_factory_{slots_, arena_};
+    Program<Word> program_{};
+    std::vector<std::size_t> block_ends_{};
+    ProgramPtr ip_{program_.begin()};
+    SlotTable slot_table_{empty_slot_table()};
+    std::vector<Word> slots_{};
+    std::vector<std::uint8_t> touched_slots_{};
+    std::vector<std::pair<Slot, Word>> seeded_registers_{};
+    std::string output_{};
+    OutputSink* sink_{nullptr};
+    TraceBuffer* trace_{nullptr};
+    bool ended_{false};
+    std::unordered_map<std::string_view, ProgramPtr> label_map_{};
+    ExecutionEngine engine_{ExecutionEngine::Threaded};
+    bool collapse_loops_{true};
+    bool propagate_constants_{false};
+    DeadCodeElimination dead_code_elimination_{DeadCodeElimination::Off};
+    std::size_t eliminated_instructions_{0};
+    bool profiling_{false};
+    ExecutionLimits limits_{};
+    RunStatus preempted_by_{RunStatus::Finished};
+    Profile profile_{};
+    CompiledProgram bytecode_{std::make_shared<Bytecode const>()};
+    std::vector<ThreadedOp> threaded_code_{};
+    std::shared_ptr<JitCode> jit_code_{};
+    std::exception_ptr jit_exception_{};
+    ReturnStack return_stack_{};
+    std::vector<std::uint8_t> uncounted_loops_{};
+    std::uint64_t executed_instructions_{0};
+};
+
+using Machine = BasicMachine<std::int32_t>;
+using Machine64 = BasicMachine<std::int64_t>;
+
+template <typename Word>
+class Instruction
+{
+  public:
+    virtual ~Instruction() = default;
+    void set_resolver(ValueResolver<Word>* resolver)
+    {
+        value_resolver_ = resolver;
+    }
+    virtual void pre_run(BasicMachine<Word>& machine) {}
+    virtual void operate_on(BasicMachine<Word>& machine) = 0;
+    virtual void compile(BytecodeBuilder& builder) const = 0;
+
+  protected:
+    ValueResolver<Word>* value_resolver_{nullptr};
+};
+
+template <typename Word>
+class NullaryInstruction : public Instruction<Word>
+{
+  public:
+    NullaryInstruction(TokenLine const& tokens, InstructionArena& arena) : Instruction<Word>() {}
+    ~NullaryInstruction() = default;
+};
+
+template <typename Word>
+class UnaryInstruction : public Instruction<Word>
+{
+  public:
+    UnaryInstruction(TokenLine const& tokens, InstructionArena& arena)
+        : Instruction<Word>(), register_{arena.intern(tokens.at(0))}
+    {
+    }
+    ~UnaryInstruction() = default;
+
+  protected:
+    std::string_view register_{};
+    Slot register_slot_{0};
+};
+
+template <typename Word>
+class BinaryInstruction : public Instruction<Word>
+{
+  public:
+    BinaryInstruction(TokenLine const& tokens, InstructionArena& arena)
+        : Instruction<Word>(), register_{arena.intern(tokens.at(0))}, value_{arena.intern(tokens.at(1))}
+    {
+    }
+    ~BinaryInstruction() = default;
+    void pre_run(BasicMachine<Word>& machine) override;
+
+  protected:
+    std::string_view register_{};
+    std::string_view value_{};
+    Slot register_slot_{0};
+    Slot value_slot_{0};
+};
+
+template <typename Word>
+class NaryInstruction : public Instruction<Word>
+{
+  public:
+    NaryInstruction(TokenLine const& tokens, InstructionArena& arena)
+        : Instruction<Word>(), arguments_{arena.resource()}
+    {
+        arguments_.reserve(tokens.size());
+        for (auto const& token : tokens)
+        {
+            arguments_.push_back(arena.intern(token));
+        }
+    }
+    ~NaryInstruction() = default;
+
+  protected:
+    std::pmr::vector<std::string_view> arguments_{};
+};
+
+#endif /* MACHINE_H */
@@ -1,441 +1,503 @@
 #include <algorithm>
-#include <cctype>
-#include <functional>
-#include <iomanip>
+#include <cstdlib>
 #include <iostream>
 #include <iterator>
-#include <memory>
-#include <regex>
-#include <sstream>
-#include <stack>
-#include <string>
-#include <unordered_map>
-#include <vector>
-
-using RawProgram = std::vector<std::string>;
-using Registers = std::unordered_map<std::string, int>;
-class Instruction;
-using Instruction_ptr = std::unique_ptr<Instruction>;
-using Program = std::vector<Instruction_ptr>;
-using ProgramPtr = Program::iterator;
-
-bool is_register(std::string const& val)
-{
-    const auto result{std::find_if(val.begin(), val.end(), [](auto const& c) { return std::isalpha(c); })};
-    return result != val.end();
+#include <limits>
+#include <stdexcept>
+#include "assembler_interpreter/src/control_flow.h"
+#include "assembler_interpreter/src/machine.h"
+#include "assembler_interpreter/src/optimizer.h"
+#include "assembler_interpreter/src/output_sink.h"
+#include "assembler_interpreter/src/program_cache.h"
+
+template <typename Word>
+void BinaryInstruction<Word>::pre_run(BasicMachine<Word>& machine)
+{
+    this->register_slot_ = machine.operand_slot(this->register_);
+    this->value_slot_ = machine.operand_slot(this->value_);
 }
 
-class ValueResolver
+template <typename Word>
+class Mov : public BinaryInstruction<Word>
 {
   public:
-    ValueResolver(Registers* registers) : registers_{registers} {}
-    int get_value_of(std::string const& in)
-    {
-        if (is_register(in))
-        {
-            return registers_->at(in);
-        }
-        else
-        {
-            const auto value_as_int{std::stoi(in)};
-            return value_as_int;
-        }
-    };
-
-  private:
-    Registers* registers_{nullptr};
+    using BinaryInstruction<Word>::BinaryInstruction;
+    void operate_on(BasicMachine<Word>& machine) override;
+    void compile(BytecodeBuilder& builder) const override;
 };
 
-class InstructionFactory
+template <typename Word>
+void Mov<Word>::operate_on(BasicMachine<Word>& machine)
 {
-  public:
-    InstructionFactory(Registers&);
-    Instruction_ptr create_instruction(std::string const& name, std::vector<std::string> const& arguments);
+    machine.get_register(this->register_slot_) = this->value_resolver_->get_value_of(this->value_slot_);
+}
 
-  private:
-    template <typename T>
-    std::unique_ptr<T> make_instruction(std::vector<std::string> const& tokens)
-    {
-        auto new_instruction{std::make_unique<T>(tokens)};
-        new_instruction->set_resolver(&value_resolver_);
-        return std::move(new_instruction);
-    }
+template <typename Word>
+void Mov<Word>::compile(BytecodeBuilder& builder) const
+{
+    builder.emit(OpCode::Mov, this->register_slot_, this->value_slot_);
+}
 
-    std::unordered_map<std::string, std::function<Instruction_ptr(std::vector<std::string>)>> instruction_map_{};
-    Registers& registers_;
-    ValueResolver value_resolver_{&registers_};
+template <typename Word>
+class Inc : public UnaryInstruction<Word>
+{
+  public:
+    using UnaryInstruction<Word>::UnaryInstruction;
+    void pre_run(BasicMachine<Word>& machine) override;
+    void operate_on(BasicMachine<Word>& machine) override;
+    void compile(BytecodeBuilder& builder) const override;
 };
 
-enum CmpStatusFlags : unsigned int
+template <typename Word>
+void Inc<Word>::pre_run(BasicMachine<Word>& machine)
 {
-    Invalid = 0,
-    Equal = 0b000001,
-    NotEqual = 0b000010,
-    GreaterOrEqual = 0b000100,
-    Greater = 0b001000,
-    LessOrEqual = 0b010000,
-    Less = 0b100000
-};
+    this->register_slot_ = machine.register_slot(this->register_);
+}
 
-class Machine
+template <typename Word>
+void Inc<Word>::operate_on(BasicMachine<Word>& machine)
 {
-  public:
-    Registers const& get_registers() const;
-    int const& get_register(std::string const&) const;
-    int& get_register(std::string const&);
-    std::string flush();
-    void _return();
-    void add_label_reference(std::string name);
-    void advance_ip(std::ptrdiff_t diff);
-    void end_execution();
-    void enter_subroutine(std::string name);
-    void jump_if_flag_is_set(std::string label, CmpStatusFlags flag);
-    void jump_to(std::string name);
-    void load_program(RawProgram const& prog);
-    void run_program();
-    void set_comparison_status_flag(CmpStatusFlags new_status);
+    auto& value{machine.get_register(this->register_slot_)};
+    value = wrapping_add(value, Word{1});
+}
 
-  public:
-    std::stringstream msg_port{};
+template <typename Word>
+void Inc<Word>::compile(BytecodeBuilder& builder) const
+{
+    builder.emit(OpCode::Inc, this->register_slot_);
+}
 
-  private:
-    void pre_run();
-
-    CmpStatusFlags comparison_status_register_{CmpStatusFlags::Invalid};
-    Instruction& get_current_instruction() const;
-    InstructionFactory instruction_factory_{registers_};
-    Program program_{};
-    ProgramPtr ip_{program_.begin()};
-    Registers registers_{};
-    std::stack<ProgramPtr> jump_stack_{};
-    std::stringstream default_out{"-1"};
-    std::stringstream* std_out{&default_out};
-    std::unordered_map<std::string, ProgramPtr> label_map_{};
-    std::vector<std::string> split_tokens(std::string const& command);
+template <typename Word>
+class Dec : public UnaryInstruction<Word>
+{
+  public:
+    using UnaryInstruction<Word>::UnaryInstruction;
+    void pre_run(BasicMachine<Word>& machine) override;
+    void operate_on(BasicMachine<Word>& machine) override;
+    void compile(BytecodeBuilder& builder) const override;
 };
 
-class Instruction
+template <typename Word>
+void Dec<Word>::pre_run(BasicMachine<Word>& machine)
 {
-  public:
-    ~Instruction() = default;
-    void set_resolver(ValueResolver* resolver)
-    {
-        value_resolver_ = resolver;
-    }
-    virtual void pre_run(Machine& machine) {}
-    virtual void operate_on(Machine& machine) = 0;
+    this->register_slot_ = machine.register_slot(this->register_);
+}
 
-  protected:
-    std::string name_{};
-    ValueResolver* value_resolver_{nullptr};
-};
+template <typename Word>
+void Dec<Word>::operate_on(BasicMachine<Word>& machine)
+{
+    auto& value{machine.get_register(this->register_slot_)};
+    value = wrapping_subtract(value, Word{1});
+}
 
-class NullaryInstruction : public Instruction
+template <typename Word>
+void Dec<Word>::compile(BytecodeBuilder& builder) const
 {
-  public:
-    NullaryInstruction(std::vector<std::string> const& tokens) : Instruction() {}
-    ~NullaryInstruction() = default;
-};
+    builder.emit(OpCode::Dec, this->register_slot_);
+}
 
-class UnaryInstruction : public Instruction
+template <typename Word>
+class Jnz : public BinaryInstruction<Word>
 {
   public:
-    UnaryInstruction(std::vector<std::string> const& tokens) : Instruction(), register_{tokens.at(0)} {}
-    ~UnaryInstruction() = default;
+    using BinaryInstruction<Word>::BinaryInstruction;
+    void operate_on(BasicMachine<Word>& machine) override;
+    void compile(BytecodeBuilder& builder) const override;
 
-  protected:
-    std::string register_{};
+  private:
+    Word calculate_jump_distance();
 };
 
-class BinaryInstruction : public Instruction
+template <typename Word>
+void Jnz<Word>::operate_on(BasicMachine<Word>& machine)
 {
-  public:
-    BinaryInstruction(std::vector<std::string> const& tokens)
-        : Instruction(), register_{tokens.at(0)}, value_{tokens.at(1)}
+    const Word jump_condition{this->value_resolver_->get_value_of(this->register_slot_)};
+    if (jump_condition != 0)
     {
+        const std::ptrdiff_t jump_distance{calculate_jump_distance()};
+        machine.advance_ip(jump_distance);
     }
-    ~BinaryInstruction() = default;
-
-  protected:
-    std::string register_{};
-    std::string value_{};
-};
+}
 
-class NaryInstruction : public Instruction
+template <typename Word>
+void Jnz<Word>::compile(BytecodeBuilder& builder) const
 {
-  public:
-    NaryInstruction(std::vector<std::string> const& tokens) : Instruction(), arguments_{tokens} {}
-    ~NaryInstruction() = default;
+    if (is_register(this->value_))
+    {
+        const auto source_index{static_cast<std::uint32_t>(builder.current_source_index())};
+        builder.emit(OpCode::JnzDynamic, source_index, this->register_slot_, this->value_slot_);
+    }
+    else
+    {
+        builder.emit_relative_jump(OpCode::Jnz, std::stoi(std::string{this->value_}), this->register_slot_);
+    }
+}
 
-  protected:
-    std::vector<std::string> arguments_{};
-};
+template <typename Word>
+Word Jnz<Word>::calculate_jump_distance()
+{
+    return this->value_resolver_->get_value_of(this->value_slot_);
+}
 
-class Mov : public BinaryInstruction
+template <typename Word>
+class Add : public BinaryInstruction<Word>
 {
   public:
-    using BinaryInstruction::BinaryInstruction;
-    void operate_on(Machine& machine) override;
+    using BinaryInstruction<Word>::BinaryInstruction;
+    void operate_on(BasicMachine<Word>& machine) override;
+    void compile(BytecodeBuilder& builder) const override;
 };
 
-void Mov::operate_on(Machine& machine)
+template <typename Word>
+void Add<Word>::operate_on(BasicMachine<Word>& machine)
 {
-    machine.get_register(register_) = value_resolver_->get_value_of(value_);
+    auto& value{machine.get_register(this->register_slot_)};
+    value = wrapping_add(value, this->value_resolver_->get_value_of(this->value_slot_));
 }
 
-class Inc : public UnaryInstruction
+template <typename Word>
+void Add<Word>::compile(BytecodeBuilder& builder) const
+{
+    builder.emit(OpCode::Add, this->register_slot_, this->value_slot_);
+}
+
+template <typename Word>
+class Sub : public BinaryInstruction<Word>
 {
   public:
-    using UnaryInstruction::UnaryInstruction;
-    void operate_on(Machine& machine) override;
+    using BinaryInstruction<Word>::BinaryInstruction;
+    void operate_on(BasicMachine<Word>& machine) override;
+    void compile(BytecodeBuilder& builder) const override;
 };
 
-void Inc::operate_on(Machine& machine)
+template <typename Word>
+void Sub<Word>::operate_on(BasicMachine<Word>& machine)
 {
-    ++(machine.get_register(register_));
+    auto& value{machine.get_register(this->register_slot_)};
+    value = wrapping_subtract(value, this->value_resolver_->get_value_of(this->value_slot_));
 }
 
-class Dec : public UnaryInstruction
+template <typename Word>
+void Sub<Word>::compile(BytecodeBuilder& builder) const
+{
+    builder.emit(OpCode::Sub, this->register_slot_, this->value_slot_);
+}
+
+template <typename Word>
+class Mul : public BinaryInstruction<Word>
 {
   public:
-    using UnaryInstruction::UnaryInstruction;
-    void operate_on(Machine& machine) override;
+    using BinaryInstruction<Word>::BinaryInstruction;
+    void operate_on(BasicMachine<Word>& machine) override;
+    void compile(BytecodeBuilder& builder) const override;
 };
 
-void Dec::operate_on(Machine& machine)
+template <typename Word>
+void Mul<Word>::operate_on(BasicMachine<Word>& machine)
 {
-    --(machine.get_register(register_));
+    auto& value{machine.get_register(this->register_slot_)};
+    value = wrapping_multiply(value, this->value_resolver_->get_value_of(this->value_slot_));
 }
 
-class Jnz : public BinaryInstruction
+template <typename Word>
+void Mul<Word>::compile(BytecodeBuilder& builder) const
 {
-  public:
-    using BinaryInstruction::BinaryInstruction;
-    void operate_on(Machine& machine) override;
+    builder.emit(OpCode::Mul, this->register_slot_, this->value_slot_);
+}
 
-  private:
-    int calculate_jump_distance();
+template <typename Word>
+class Div : public BinaryInstruction<Word>
+{
+  public:
+    using BinaryInstruction<Word>::BinaryInstruction;
+    void operate_on(BasicMachine<Word>& machine) override;
+    void compile(BytecodeBuilder& builder) const override;
 };
 
-void Jnz::operate_on(Machine& machine)
+template <typename Word>
+void Div<Word>::operate_on(BasicMachine<Word>& machine)
 {
-    const int jump_condition{value_resolver_->get_value_of(register_)};
-    if (jump_condition != 0)
-    {
-        const std::ptrdiff_t jump_distance{calculate_jump_distance()};
-        machine.advance_ip(jump_distance);
-    }
+    auto& dividend{machine.get_register(this->register_slot_)};
+    dividend = wrapping_divide(dividend, this->value_resolver_->get_value_of(this->value_slot_));
 }
 
-int Jnz::calculate_jump_distance()
+template <typename Word>
+void Div<Word>::compile(BytecodeBuilder& builder) const
 {
-    return value_resolver_->get_value_of(value_);
+    builder.emit(OpCode::Div, this->register_slot_, this->value_slot_);
 }
 
-class Add : public BinaryInstruction
+template <typename Word>
+class End : public NullaryInstruction<Word>
 {
   public:
-    using BinaryInstruction::BinaryInstruction;
-    void operate_on(Machine& machine) override;
+    using NullaryInstruction<Word>::NullaryInstruction;
+    void operate_on(BasicMachine<Word>& machine) override;
+    void compile(BytecodeBuilder& builder) const override;
 };
 
-void Add::operate_on(Machine& machine)
+template <typename Word>
+void End<Word>::operate_on(BasicMachine<Word>& machine)
+{
+    machine.end_execution();
+}
+
+template <typename Word>
+void End<Word>::compile(BytecodeBuilder& builder) const
 {
-    machine.get_register(register_) = machine.get_register(register_) + value_resolver_->get_value_of(value_);
+    builder.emit(OpCode::End);
 }
 
-class Sub : public BinaryInstruction
+template <typename Word>
+class Msg : public NaryInstruction<Word>
 {
   public:
-    using BinaryInstruction::BinaryInstruction;
-    void operate_on(Machine& machine) override;
+    using NaryInstruction<Word>::NaryInstruction;
+    void pre_run(BasicMachine<Word>& machine) override;
+    void operate_on(BasicMachine<Word>& machine) override;
+    void compile(BytecodeBuilder& builder) const override;
+
+  private:
+    static bool is_arg_text(std::string_view arg);
+    static std::string strippedQuotes(std::string_view arg);
+
+    MessageTemplate message_{};
 };
+template <typename Word>
+bool Msg<Word>::is_arg_text(std::string_view arg)
+{
+    return arg.find("'") != std::string_view::npos;
+}
+template <typename Word>
+std::string Msg<Word>::strippedQuotes(std::string_view arg)
+{
+    std::string stripped{arg};
+    stripped.erase(std::remove(stripped.begin(), stripped.end(), '\''), stripped.end());
+    return stripped;
+}
 
-void Sub::operate_on(Machine& machine)
+template <typename Word>
+void Msg<Word>::pre_run(BasicMachine<Word>& machine)
 {
-    machine.get_register(register_) = machine.get_register(register_) - value_resolver_->get_value_of(value_);
+    message_ = {};
+    for (auto const& arg : this->arguments_)
+    {
+        if (Msg::is_arg_text(arg))
+        {
+            message_.add_text(Msg::strippedQuotes(arg));
+        }
+        else
+        {
+            message_.add_value(machine.operand_slot(arg));
+        }
+    }
 }
 
-class Mul : public BinaryInstruction
+template <typename Word>
+void Msg<Word>::operate_on(BasicMachine<Word>& machine)
 {
-  public:
-    using BinaryInstruction::BinaryInstruction;
-    void operate_on(Machine& machine) override;
-};
+    machine.write_message(message_);
+}
 
-void Mul::operate_on(Machine& machine)
+template <typename Word>
+void Msg<Word>::compile(BytecodeBuilder& builder) const
 {
-    machine.get_register(register_) = machine.get_register(register_) * value_resolver_->get_value_of(value_);
+    builder.emit(OpCode::Msg, builder.add_message(message_));
 }
 
-class Div : public BinaryInstruction
+template <typename Word>
+class Label : public UnaryInstruction<Word>
 {
   public:
-    using BinaryInstruction::BinaryInstruction;
-    void operate_on(Machine& machine) override;
+    using UnaryInstruction<Word>::UnaryInstruction;
+    void pre_run(BasicMachine<Word>& machine) override;
+    void operate_on(BasicMachine<Word>& machine) override;
+    void compile(BytecodeBuilder& builder) const override;
 };
 
-void Div::operate_on(Machine& machine)
+template <typename Word>
+void Label<Word>::pre_run(BasicMachine<Word>& machine)
 {
-    machine.get_register(register_) = machine.get_register(register_) / value_resolver_->get_value_of(value_);
+    machine.add_label_reference(this->register_);
 }
 
-class End : public NullaryInstruction
-{
-  public:
-    using NullaryInstruction::NullaryInstruction;
-    void operate_on(Machine& machine) override;
-};
+template <typename Word>
+void Label<Word>::operate_on(BasicMachine<Word>& machine) {}
 
-void End::operate_on(Machine& machine)
+template <typename Word>
+void Label<Word>::compile(BytecodeBuilder& builder) const
 {
-    machine.end_execution();
+    builder.define_label(this->register_);
 }
 
-class Msg : public NaryInstruction
+// Jump whose label is looked up when it is first taken after a load, later runs go straight to it.
+template <typename Word>
+class LabelJumpInstruction : public UnaryInstruction<Word>
 {
   public:
-    using NaryInstruction::NaryInstruction;
-    void operate_on(Machine& machine) override;
+    using UnaryInstruction<Word>::UnaryInstruction;
+    void pre_run(BasicMachine<Word>& machine) override;
+
+  protected:
+    std::size_t target(BasicMachine<Word>& machine);
 
   private:
-    static bool is_arg_text(std::string const& arg);
-    static std::string strippedQuotes(std::string arg);
+    std::size_t target_{0};
+    bool is_resolved_{false};
 };
-bool Msg::is_arg_text(std::string const& arg)
-{
-    return arg.find("'") != std::string::npos;
-}
-std::string Msg::strippedQuotes(std::string arg)
+
+template <typename Word>
+void LabelJumpInstruction<Word>::pre_run(BasicMachine<Word>& machine)
 {
-    arg.erase(std::remove(arg.begin(), arg.end(), '\''), arg.end());
-    return arg;
+    is_resolved_ = false;
 }
 
-void Msg::operate_on(Machine& machine)
+template <typename Word>
+std::size_t LabelJumpInstruction<Word>::target(BasicMachine<Word>& machine)
 {
-    std::transform(arguments_.begin(),
-                   arguments_.end(),
-                   std::ostream_iterator<std::string>(machine.msg_port, ""),
-                   [this](auto const& arg) {
-                       if (Msg::is_arg_text(arg))
-                       {
-                           return Msg::strippedQuotes(arg);
-                       }
-                       else
-                       {
-                           return std::to_string(value_resolver_->get_value_of(arg));
-                       }
-                   });
+    if (!is_resolved_)
+    {
+        target_ = machine.label_position(this->register_);
+        is_resolved_ = true;
+    }
+    return target_;
 }
 
-class Label : public UnaryInstruction
+template <typename Word>
+class Call : public LabelJumpInstruction<Word>
 {
   public:
-    using UnaryInstruction::UnaryInstruction;
-    void pre_run(Machine& machine) override;
-    void operate_on(Machine& machine) override;
+    using LabelJumpInstruction<Word>::LabelJumpInstruction;
+    void operate_on(BasicMachine<Word>& machine) override;
+    void compile(BytecodeBuilder& builder) const override;
 };
 
-void Label::pre_run(Machine& machine)
+template <typename Word>
+void Call<Word>::operate_on(BasicMachine<Word>& machine)
 {
-    machine.add_label_reference(register_);
+    machine.enter_subroutine(this->target(machine));
 }
 
-void Label::operate_on(Machine& machine) {}
-
-class Call : public UnaryInstruction
-{
-  public:
-    using UnaryInstruction::UnaryInstruction;
-    void operate_on(Machine& machine) override;
-};
-
-void Call::operate_on(Machine& machine)
+template <typename Word>
+void Call<Word>::compile(BytecodeBuilder& builder) const
 {
-    machine.enter_subroutine(register_);
+    builder.emit_label_jump(OpCode::Call, this->register_);
 }
 
-class Ret : public NullaryInstruction
+template <typename Word>
+class Ret : public NullaryInstruction<Word>
 {
   public:
-    using NullaryInstruction::NullaryInstruction;
-    void operate_on(Machine& machine) override;
+    using NullaryInstruction<Word>::NullaryInstruction;
+    void operate_on(BasicMachine<Word>& machine) override;
+    void compile(BytecodeBuilder& builder) const override;
 };
 
-void Ret::operate_on(Machine& machine)
+template <typename Word>
+void Ret<Word>::operate_on(BasicMachine<Word>& machine)
 {
     machine._return();
 }
 
-class Jmp : public UnaryInstruction
+template <typename Word>
+void Ret<Word>::compile(BytecodeBuilder& builder) const
+{
+    builder.emit(OpCode::Ret);
+}
+
+template <typename Word>
+class Jmp : public LabelJumpInstruction<Word>
 {
   public:
-    using UnaryInstruction::UnaryInstruction;
-    void operate_on(Machine& machine) override;
+    using LabelJumpInstruction<Word>::LabelJumpInstruction;
+    void operate_on(BasicMachine<Word>& machine) override;
+    void compile(BytecodeBuilder& builder) const override;
 };
 
-void Jmp::operate_on(Machine& machine)
+template <typename Word>
+void Jmp<Word>::operate_on(BasicMachine<Word>& machine)
+{
+    machine.jump_to(this->target(machine));
+}
+
+template <typename Word>
+void Jmp<Word>::compile(BytecodeBuilder& builder) const
 {
-    machine.jump_to(register_);
+    builder.emit_label_jump(OpCode::Jmp, this->register_);
 }
 
-class Cmp : public BinaryInstruction
+template <typename Word>
+class Cmp : public BinaryInstruction<Word>
 {
   public:
-    using BinaryInstruction::BinaryInstruction;
-    void operate_on(Machine& machine) override;
+    using BinaryInstruction<Word>::BinaryInstruction;
+    void operate_on(BasicMachine<Word>& machine) override;
+    void compile(BytecodeBuilder& builder) const override;
 };
 
-void Cmp::operate_on(Machine& machine)
+template <typename Word>
+void Cmp<Word>::operate_on(BasicMachine<Word>& machine)
 {
-    auto const lhs{value_resolver_->get_value_of(register_)};
-    auto const rhs{value_resolver_->get_value_of(value_)};
-
-    machine.set_comparison_status_flag(CmpStatusFlags::Invalid);
-    if (lhs == rhs)
-    {
-        machine.set_comparison_status_flag(CmpStatusFlags::Equal);
-        machine.set_comparison_status_flag(CmpStatusFlags::LessOrEqual);
-        machine.set_comparison_status_flag(CmpStatusFlags::GreaterOrEqual);
-    }
-    else
-    {
-        machine.set_comparison_status_flag(CmpStatusFlags::NotEqual);
-    }
+    machine.set_comparison(this->value_resolver_->get_value_of(this->register_slot_),
+                           this->value_resolver_->get_value_of(this->value_slot_));
+}
 
-    if (lhs < rhs)
-    {
-        machine.set_comparison_status_flag(CmpStatusFlags::Less);
-        machine.set_comparison_status_flag(CmpStatusFlags::LessOrEqual);
-    }
+template <typename Word>
+void Cmp<Word>::compile(BytecodeBuilder& builder) const
+{
+    builder.emit(OpCode::Cmp, this->register_slot_, this->value_slot_);
+}
 
-    if (lhs > rhs)
+OpCode jump_opcode_of(CmpStatusFlags flag)
+{
+    switch (flag)
     {
-        machine.set_comparison_status_flag(CmpStatusFlags::Greater);
-        machine.set_comparison_status_flag(CmpStatusFlags::GreaterOrEqual);
+        case CmpStatusFlags::Equal:
+            return OpCode::Je;
+        case CmpStatusFlags::NotEqual:
+            return OpCode::Jne;
+        case CmpStatusFlags::GreaterOrEqual:
+            return OpCode::Jge;
+        case CmpStatusFlags::Greater:
+            return OpCode::Jg;
+        case CmpStatusFlags::LessOrEqual:
+            return OpCode::Jle;
+        case CmpStatusFlags::Less:
+            return OpCode::Jl;
+        default:
+            throw std::invalid_argument("No conditional jump for flag");
     }
 }
 
-class ConditionalJumpInstruction : public UnaryInstruction
+template <typename Word>
+class ConditionalJumpInstruction : public LabelJumpInstruction<Word>
 {
   public:
-    using UnaryInstruction::UnaryInstruction;
-    void operate_on(Machine& machine) override;
+    using LabelJumpInstruction<Word>::LabelJumpInstruction;
+    void operate_on(BasicMachine<Word>& machine) override;
+    void compile(BytecodeBuilder& builder) const override;
 
   protected:
     virtual CmpStatusFlags get_instruction_flag() const = 0;
 };
 
-void ConditionalJumpInstruction::operate_on(Machine& machine)
+template <typename Word>
+void ConditionalJumpInstruction<Word>::operate_on(BasicMachine<Word>& machine)
 {
-    machine.jump_if_flag_is_set(register_, get_instruction_flag());
+    machine.jump_if_flag_is_set(this->target(machine), get_instruction_flag());
 }
 
-class Jne : public ConditionalJumpInstruction
+template <typename Word>
+void ConditionalJumpInstruction<Word>::compile(BytecodeBuilder& builder) const
+{
+    builder.emit_label_jump(jump_opcode_of(get_instruction_flag()), this->register_);
+}
+
+template <typename Word>
+class Jne : public ConditionalJumpInstruction<Word>
 {
   public:
-    using ConditionalJumpInstruction::ConditionalJumpInstruction;
+    using ConditionalJumpInstruction<Word>::ConditionalJumpInstruction;
 
   protected:
     CmpStatusFlags get_instruction_flag() const override
@@ -444,10 +506,11 @@ class Jne : public ConditionalJumpInstruction
     }
 };
 
-class Je : public ConditionalJumpInstruction
+template <typename Word>
+class Je : public ConditionalJumpInstruction<Word>
 {
   public:
-    using ConditionalJumpInstruction::ConditionalJumpInstruction;
+    using ConditionalJumpInstruction<Word>::ConditionalJumpInstruction;
 
   protected:
     CmpStatusFlags get_instruction_flag() const override
@@ -456,10 +519,11 @@ class Je : public ConditionalJumpInstruction
     }
 };
 
-class Jge : public ConditionalJumpInstruction
+template <typename Word>
+class Jge : public ConditionalJumpInstruction<Word>
 {
   public:
-    using ConditionalJumpInstruction::ConditionalJumpInstruction;
+    using ConditionalJumpInstruction<Word>::ConditionalJumpInstruction;
 
   protected:
     CmpStatusFlags get_instruction_flag() const override
@@ -468,10 +532,11 @@ class Jge : public ConditionalJumpInstruction
     }
 };
 
-class Jg : public ConditionalJumpInstruction
+template <typename Word>
+class Jg : public ConditionalJumpInstruction<Word>
 {
   public:
-    using ConditionalJumpInstruction::ConditionalJumpInstruction;
+    using ConditionalJumpInstruction<Word>::ConditionalJumpInstruction;
 
   protected:
     CmpStatusFlags get_instruction_flag() const override
@@ -480,10 +545,11 @@ class Jg : public ConditionalJumpInstruction
     }
 };
 
-class Jle : public ConditionalJumpInstruction
+template <typename Word>
+class Jle : public ConditionalJumpInstruction<Word>
 {
   public:
-    using ConditionalJumpInstruction::ConditionalJumpInstruction;
+    using ConditionalJumpInstruction<Word>::ConditionalJumpInstruction;
 
   protected:
     CmpStatusFlags get_instruction_flag() const override
@@ -492,10 +558,11 @@ class Jle : public ConditionalJumpInstruction
     }
 };
 
-class Jl : public ConditionalJumpInstruction
+template <typename Word>
+class Jl : public ConditionalJumpInstruction<Word>
 {
   public:
-    using ConditionalJumpInstruction::ConditionalJumpInstruction;
+    using ConditionalJumpInstruction<Word>::ConditionalJumpInstruction;
 
   protected:
     CmpStatusFlags get_instruction_flag() const override
@@ -504,47 +571,76 @@ class Jl : public ConditionalJumpInstruction
     }
 };
 
-InstructionFactory::InstructionFactory(Registers& registers) : registers_{registers}
-{
-    instruction_map_.emplace("mov", [this](auto const& tokens) { return make_instruction<Mov>(tokens); });
-    instruction_map_.emplace("jnz", [this](auto const& tokens) { return make_instruction<Jnz>(tokens); });
-    instruction_map_.emplace("inc", [this](auto const& tokens) { return make_instruction<Inc>(tokens); });
-    instruction_map_.emplace("dec", [this](auto const& tokens) { return make_instruction<Dec>(tokens); });
-    instruction_map_.emplace("add", [this](auto const& tokens) { return make_instruction<Add>(tokens); });
-    instruction_map_.emplace("sub", [this](auto const& tokens) { return make_instruction<Sub>(tokens); });
-    instruction_map_.emplace("mul", [this](auto const& tokens) { return make_instruction<Mul>(tokens); });
-    instruction_map_.emplace("div", [this](auto const& tokens) { return make_instruction<Div>(tokens); });
-    instruction_map_.emplace("end", [this](auto const& tokens) { return make_instruction<End>(tokens); });
-    instruction_map_.emplace("msg", [this](auto const& tokens) { return make_instruction<Msg>(tokens); });
-    instruction_map_.emplace("label", [this](auto const& tokens) { return make_instruction<Label>(tokens); });
-    instruction_map_.emplace("call", [this](auto const& tokens) { return make_instruction<Call>(tokens); });
-    instruction_map_.emplace("ret", [this](auto const& tokens) { return make_instruction<Ret>(tokens); });
-    instruction_map_.emplace("jmp", [this](auto const& tokens) { return make_instruction<Jmp>(tokens); });
-    instruction_map_.emplace("cmp", [this](auto const& tokens) { return make_instruction<Cmp>(tokens); });
-    instruction_map_.emplace("jne", [this](auto const& tokens) { return make_instruction<Jne>(tokens); });
-    instruction_map_.emplace("je", [this](auto const& tokens) { return make_instruction<Je>(tokens); });
-    instruction_map_.emplace("jge", [this](auto const& tokens) { return make_instruction<Jge>(tokens); });
-    instruction_map_.emplace("jg", [this](auto const& tokens) { return make_instruction<Jg>(tokens); });
-    instruction_map_.emplace("jle", [this](auto const& tokens) { return make_instruction<Jle>(tokens); });
-    instruction_map_.emplace("jl", [this](auto const& tokens) { return make_instruction<Jl>(tokens); });
-}
-
-Instruction_ptr InstructionFactory::create_instruction(std::string const& name,
-                                                       std::vector<std::string> const& arguments)
+std::string_view InstructionArena::intern(std::string_view text)
 {
+    const auto interned{strings_.find(text)};
+    if (interned != strings_.end())
+    {
+        return *interned;
+    }
+    auto* const characters{static_cast<char*>(resource_.allocate(text.size(), alignof(char)))};
+    std::copy(text.begin(), text.end(), characters);
+    return *strings_.emplace(characters, text.size()).first;
+}
+
+std::pmr::memory_resource* InstructionArena::resource()
+{
+    return &resource_;
+}
+
+// Every instruction created in the arena has to be destroyed before its memory is given back.
+void InstructionArena::release()
+{
+    std::pmr::unordered_set<std::string_view>{&resource_}.swap(strings_);
+    resource_.release();
+}
+
+template <typename Word>
+InstructionFactory<Word>::InstructionFactory(std::vector<Word>& slots, InstructionArena& arena)
+    : arena_{&arena}, value_resolver_{&slots}
+{
+}
+
+template <typename Word>
+Instruction_ptr<Word> InstructionFactory<Word>::create_instruction(Token name, TokenLine const& arguments)
+{
+    using Maker = Instruction_ptr<Word> (InstructionFactory::*)(TokenLine const&);
+    static const std::unordered_map<Token, Maker> instruction_map{
+        {"mov", &InstructionFactory::make_instruction<Mov<Word>>},
+        {"jnz", &InstructionFactory::make_instruction<Jnz<Word>>},
+        {"inc", &InstructionFactory::make_instruction<Inc<Word>>},
+        {"dec", &InstructionFactory::make_instruction<Dec<Word>>},
+        {"add", &InstructionFactory::make_instruction<Add<Word>>},
+        {"sub", &InstructionFactory::make_instruction<Sub<Word>>},
+        {"mul", &InstructionFactory::make_instruction<Mul<Word>>},
+        {"div", &InstructionFactory::make_instruction<Div<Word>>},
+        {"end", &InstructionFactory::make_instruction<End<Word>>},
+        {"msg", &InstructionFactory::make_instruction<Msg<Word>>},
+        {"label", &InstructionFactory::make_instruction<Label<Word>>},
+        {"call", &InstructionFactory::make_instruction<Call<Word>>},
+        {"ret", &InstructionFactory::make_instruction<Ret<Word>>},
+        {"jmp", &InstructionFactory::make_instruction<Jmp<Word>>},
+        {"cmp", &InstructionFactory::make_instruction<Cmp<Word>>},
+        {"jne", &InstructionFactory::make_instruction<Jne<Word>>},
+        {"je", &InstructionFactory::make_instruction<Je<Word>>},
+        {"jge", &InstructionFactory::make_instruction<Jge<Word>>},
+        {"jg", &InstructionFactory::make_instruction<Jg<Word>>},
+        {"jle", &InstructionFactory::make_instruction<Jle<Word>>},
+        {"jl", &InstructionFactory::make_instruction<Jl<Word>>}};
+
     const auto find_iter{name.find(":")};
-    const auto is_label{find_iter != std::string::npos};
+    const auto is_label{find_iter != Token::npos};
     if (is_label)
     {
-        std::vector<std::string> tmp_arguments{arguments.begin(), arguments.end()};
+        TokenLine tmp_arguments{arguments.begin(), arguments.end()};
         tmp_arguments.push_back(name.substr(0, find_iter));
-        return instruction_map_.at("label")(tmp_arguments);
+        return (this->*instruction_map.at("label"))(tmp_arguments);
     }
     else
     {
         try
         {
-            return instruction_map_.at(name)(arguments);
+            return (this->*instruction_map.at(name))(arguments);
         }
         catch (std::exception e)
         {
@@ -555,200 +651,848 @@ Instruction_ptr InstructionFactory::create_instruction(std::string const& name,
     }
 }
 
-Instruction& Machine::get_current_instruction() const
+template <typename Word>
+Instruction<Word>& BasicMachine<Word>::get_current_instruction() const
 {
     auto& is{*(ip_->get())};
     return is;
 }
 
-void Machine::advance_ip(std::ptrdiff_t diff)
+// Leaves ip_ in front of the jump target, the run loop steps onto it. Targets behind the program clamp to its end.
+template <typename Word>
+void BasicMachine<Word>::advance_ip(std::ptrdiff_t diff)
+{
+    const auto source_index{static_cast<std::size_t>(std::distance(program_.begin(), ip_))};
+    const auto target{resolve_relative_jump(source_index, diff, program_.size())};
+    ip_ = std::next(program_.begin(), static_cast<std::ptrdiff_t>(target) - 1);
+}
+template <typename Word>
+void BasicMachine<Word>::end_execution()
+{
+    ended_ = true;
+    ip_ = next(program_.end(), -1);
+}
+template <typename Word>
+void BasicMachine<Word>::load_program(RawProgram const& prog)
 {
-    const auto new_position{next(ip_, diff - 1)};
-    const bool is_after_begin{new_position >= program_.begin()};
-    const bool is_before_end{new_position <= program_.end()};
-    const bool is_new_position_in_range{is_after_begin && is_before_end};
-    if (is_new_position_in_range)
+    parse_program(prog);
+    pre_run();
+    compile();
+}
+
+template <typename Word>
+void BasicMachine<Word>::load_program(std::string_view source)
+{
+    parse_program(source);
+    pre_run();
+    compile();
+}
+
+template <typename Word>
+void BasicMachine<Word>::parse_program(RawProgram const& prog)
+{
+    TokenLine tokens{};
+    TokenLine arguments{};
+    for (auto const& instruction : prog)
     {
-        std::advance(ip_, --diff);
+        Lexer lexer{instruction};
+        while (lexer.next_line(tokens))
+        {
+            load_instruction(tokens, arguments);
+        }
     }
-    else
+}
+
+template <typename Word>
+void BasicMachine<Word>::parse_program(std::string_view source)
+{
+    TokenLine tokens{};
+    TokenLine arguments{};
+    Lexer lexer{source};
+    while (lexer.next_line(tokens))
     {
-        std::advance(ip_, 1);
+        load_instruction(tokens, arguments);
     }
 }
-void Machine::end_execution()
+
+template <typename Word>
+void BasicMachine<Word>::load_instruction(TokenLine const& tokens, TokenLine& arguments)
 {
-    std_out = &msg_port;
-    ip_ = next(program_.end(), -1);
+    arguments.assign(std::next(tokens.begin(), 1), tokens.end());
+    program_.push_back(instruction_factory_.create_instruction(tokens.front(), arguments));
 }
-void Machine::load_program(RawProgram const& prog)
+
+template <typename Word>
+void BasicMachine<Word>::pre_run()
 {
-    for (auto instruction : prog)
+    for (ip_ = program_.begin(); ip_ != program_.end(); std::advance(ip_, 1))
     {
-        auto tokens{split_tokens(instruction)};
-        program_.push_back(
-            instruction_factory_.create_instruction(tokens.front(), {std::next(tokens.begin(), 1), tokens.end()}));
+        get_current_instruction().pre_run(*this);
     }
-    pre_run();
 }
 
-void Machine::pre_run()
+template <typename Word>
+void BasicMachine<Word>::compile()
 {
-    for (ip_ = program_.begin(); ip_ != program_.end(); std::advance(ip_, 1))
+    BytecodeBuilder builder{program_.size(), slot_table_};
+    for (std::size_t index{0}; index < program_.size(); ++index)
     {
-        get_current_instruction().pre_run(*this);
+        builder.begin_instruction(index);
+        program_[index]->compile(builder);
     }
+    auto bytecode{builder.finish()};
+    fuse_superinstructions(bytecode);
+    eliminate_tail_calls(bytecode);
+    find_source_blocks(bytecode);
+    eliminated_instructions_ = propagate_constants_ ? propagate_constants<Word>(bytecode) : 0;
+    if (dead_code_elimination_ != DeadCodeElimination::Off)
+    {
+        const bool registers_observed{dead_code_elimination_ == DeadCodeElimination::KeepRegisters};
+        eliminated_instructions_ += eliminate_dead_code(bytecode, registers_observed);
+    }
+    if (collapse_loops_)
+    {
+        collapse_counting_loops(bytecode);
+    }
+    bytecode_ = std::make_shared<Bytecode const>(std::move(bytecode));
+    seeded_registers_.clear();
+    threaded_code_.clear();
+    jit_code_.reset();
 }
 
-void Machine::run_program()
+// Instructions belong to the block of the op they compile to, labels to the block of the op following them.
+// Branching ops end their blocks, so each source instruction that can jump ends its source block too. The
+// instruction objects still run the jumps constant propagation drops, their blocks come from the bytecode before it.
+template <typename Word>
+void BasicMachine<Word>::find_source_blocks(Bytecode const& bytecode)
+{
+    auto const& source_to_code{bytecode.source_to_code};
+    const auto source_begin{source_to_code.begin()};
+    const ControlFlowGraph graph{bytecode};
+    const auto size{program_.size()};
+    block_ends_.resize(size);
+    for (std::size_t index{0}; index < size; ++index)
+    {
+        const auto op{source_to_code[index]};
+        if (op >= bytecode.code.size())
+        {
+            block_ends_[index] = size;
+            continue;
+        }
+        const auto block_end{graph.blocks()[graph.block_of(op)].end};
+        const auto source_end{std::lower_bound(std::next(source_begin, static_cast<std::ptrdiff_t>(index + 1)),
+                                               std::next(source_begin, static_cast<std::ptrdiff_t>(size)),
+                                               block_end)};
+        block_ends_[index] = static_cast<std::size_t>(std::distance(source_begin, source_end));
+    }
+}
+
+template <typename Word>
+CompiledProgram BasicMachine<Word>::compiled_program() const
 {
-    for (ip_ = program_.begin(); ip_ != program_.end(); std::advance(ip_, 1))
+    return bytecode_;
+}
+
+// Machines loaded this way have no instruction objects, the reference engine runs the bytecode for them. Programs
+// holding values a Word cannot represent throw std::out_of_range and leave the machine as it was.
+template <typename Word>
+void BasicMachine<Word>::load_program(CompiledProgram program)
+{
+    auto const& values{program->initial_slot_values};
+    const auto fits{[](SlotValue value) {
+        return value >= std::numeric_limits<Word>::min() && value <= std::numeric_limits<Word>::max();
+    }};
+    if (!std::all_of(values.begin(), values.end(), fits))
     {
-        get_current_instruction().operate_on(*this);
+        throw std::out_of_range{"Program values do not fit the machine word"};
     }
+    program_.clear();
+    block_ends_.clear();
+    eliminated_instructions_ = 0;
+    label_map_.clear();
+    arena_.release();
+    slot_table_ = empty_slot_table();
+    bytecode_ = std::move(program);
+    seeded_registers_.clear();
+    threaded_code_.clear();
+    jit_code_.reset();
 }
 
-int const& Machine::get_register(std::string const& register_name) const
+template <typename Word>
+SlotTable BasicMachine<Word>::empty_slot_table()
 {
-    return registers_.at(register_name);
+    return {std::numeric_limits<Word>::min(), std::numeric_limits<Word>::max()};
 }
 
-int& Machine::get_register(std::string const& register_name)
+template <typename Word>
+std::size_t BasicMachine<Word>::program_size() const
 {
-    return registers_[register_name];
+    return program_.size();
 }
 
-Registers const& Machine::get_registers() const
+template <typename Word>
+void BasicMachine<Word>::set_engine(ExecutionEngine engine)
 {
-    return registers_;
+    engine_ = engine;
 }
 
-std::string Machine::flush()
+// A run stopped by one of the limits returns the limit it hit and keeps its registers, its output is discarded
+// like the one of any run that did not end. Zero limits leave runs unbounded.
+template <typename Word>
+void BasicMachine<Word>::set_execution_limits(ExecutionLimits const& limits)
 {
-    return std_out->str();
+    limits_ = limits;
 }
 
-void Machine::add_label_reference(std::string name)
+template <typename Word>
+void BasicMachine<Word>::set_loop_collapsing(bool enabled)
 {
-    label_map_[name] = ip_;
+    collapse_loops_ = enabled;
 }
 
-void Machine::enter_subroutine(std::string name)
+// The optimizations take effect on the programs loaded afterwards, eliminated_instructions() counts the ops they
+// removed from the last one.
+template <typename Word>
+void BasicMachine<Word>::set_constant_propagation(bool enabled)
 {
-    jump_stack_.push(ip_);
-    jump_to(name);
+    propagate_constants_ = enabled;
 }
 
-void Machine::jump_to(std::string name)
+// The registers of a run stopped by a limit may lack writes dead code elimination removed, even with
+// KeepRegisters.
+template <typename Word>
+void BasicMachine<Word>::set_dead_code_elimination(DeadCodeElimination mode)
 {
-    ip_ = label_map_.at(name);
+    dead_code_elimination_ = mode;
 }
 
-void Machine::_return()
+template <typename Word>
+std::size_t BasicMachine<Word>::eliminated_instructions() const
 {
-    ip_ = jump_stack_.top();
-    jump_stack_.pop();
+    return eliminated_instructions_;
 }
 
-void Machine::set_comparison_status_flag(CmpStatusFlags new_status)
+// Runs under execution limits, with profiling or with tracing go through the bytecode loop whatever the engine.
+template <typename Word>
+RunStatus BasicMachine<Word>::run_program()
 {
-    if (new_status == CmpStatusFlags::Invalid)
+    reset_execution();
+    if (profiling_)
     {
-        comparison_status_register_ = CmpStatusFlags::Invalid;
+        run_profiled();
+    }
+    else if (trace_)
+    {
+        run_traced();
+    }
+    else if (limits_.counted())
+    {
+        run_limited();
     }
     else
     {
-        comparison_status_register_ = static_cast<CmpStatusFlags>(comparison_status_register_ | new_status);
+        switch (engine_)
+        {
+            case ExecutionEngine::Reference:
+                if (program_.empty())
+                {
+                    run_threaded();
+                    break;
+                }
+                run_reference();
+                break;
+            case ExecutionEngine::Bytecode:
+                run_bytecode();
+                break;
+            case ExecutionEngine::Threaded:
+                run_threaded();
+                break;
+            case ExecutionEngine::Jit:
+                run_jit();
+                break;
+        }
     }
+    finish_output();
+    return ended_ ? RunStatus::Ended : preempted_by_;
 }
 
-void Machine::jump_if_flag_is_set(std::string label, CmpStatusFlags flag)
+// The ops a profile reports are the ones of the bytecode loop.
+template <typename Word>
+void BasicMachine<Word>::run_profiled()
 {
-    if (comparison_status_register_ & flag)
+    Profiler::Labels labels{};
+    for (auto const& label : label_map_)
     {
-        jump_to(label);
+        const auto source_index{static_cast<std::size_t>(std::distance(program_.begin(), label.second))};
+        labels.emplace_back(std::string{label.first}, bytecode_->source_to_code[source_index]);
     }
+    Profiler profiler{*bytecode_, std::move(labels)};
+    run_within_limits(profiler);
+    profile_ = profiler.finish();
 }
 
-Registers assembler(RawProgram const& program)
+// A profiled run is not traced.
+template <typename Word>
+void BasicMachine<Word>::run_traced()
 {
-    Machine machine{};
-    machine.load_program(program);
-    machine.run_program();
-    return machine.get_registers();
+    Tracer<Word> tracer{*trace_, *bytecode_, slots_.data()};
+    run_within_limits(tracer);
 }
 
-class TokenSplitter
+template <typename Word>
+void BasicMachine<Word>::run_limited()
 {
-  public:
-    TokenSplitter(std::string const& raw_token) : raw_token_{raw_token}
+    Unprofiled hooks{};
+    run_within_limits(hooks);
+}
+
+template <typename Word>
+template <typename Hooks>
+void BasicMachine<Word>::run_within_limits(Hooks& hooks)
+{
+    if (!limits_.counted())
     {
-        parse();
+        run_bytecode(hooks);
+        return;
     }
-    std::vector<std::string> get_tokens()
+    Limited<Hooks> limited{hooks, limits_};
+    run_bytecode(limited);
+    executed_instructions_ = limited.executed();
+    preempted_by_ = limited.status();
+}
+
+// Runs a block at a time. Only the last instruction of a block can move ip_, the ones before it run straight.
+template <typename Word>
+void BasicMachine<Word>::run_reference()
+{
+    const auto begin{program_.begin()};
+    for (ip_ = begin; ip_ != program_.end(); std::advance(ip_, 1))
     {
-        return splitup_tokens_;
+        const auto last{std::next(begin, block_ends_[static_cast<std::size_t>(std::distance(begin, ip_))] - 1)};
+        executed_instructions_ += static_cast<std::uint64_t>(std::distance(ip_, last)) + 1;
+        for (; ip_ != last; std::advance(ip_, 1))
+        {
+            get_current_instruction().operate_on(*this);
+        }
+        get_current_instruction().operate_on(*this);
     }
+}
 
-  private:
-    void parse();
-    std::vector<std::string> splitup_tokens_{};
-    std::string raw_token_{};
-};
+template <typename Word>
+std::uint64_t BasicMachine<Word>::executed_instructions() const
+{
+    return executed_instructions_;
+}
 
-std::vector<std::string> Machine::split_tokens(std::string const& command)
+template <typename Word>
+void BasicMachine<Word>::run_bytecode()
 {
-    return TokenSplitter(command).get_tokens();
+    Unprofiled hooks{};
+    run_bytecode(hooks);
 }
 
-void ltrim(std::string& s)
+template <typename Word>
+template <typename Hooks>
+void BasicMachine<Word>::run_bytecode(Hooks& hooks)
 {
-    s.erase(s.begin(), std::find_if(s.begin(), s.end(), [](int ch) { return !std::isspace(ch); }));
+    return_stack_.clear();
+
+    Word* const slots{slots_.data()};
+    std::uint8_t* const touched{touched_slots_.data()};
+    Op const* const code{bytecode_->code.data()};
+    const std::uint32_t end{static_cast<std::uint32_t>(bytecode_->code.size())};
+    std::uint32_t ip{0};
+    while (ip < end)
+    {
+        hooks.execute(ip);
+        const auto executed{ip};
+        Op const& op{code[ip++]};
+        switch (op.code)
+        {
+            case OpCode::Mov:
+                slots[op.a] = slots[op.b];
+                touched[op.a] = 1;
+                break;
+            case OpCode::Inc:
+                slots[op.a] = wrapping_add(slots[op.a], Word{1});
+                touched[op.a] = 1;
+                break;
+            case OpCode::Dec:
+                slots[op.a] = wrapping_subtract(slots[op.a], Word{1});
+                touched[op.a] = 1;
+                break;
+            case OpCode::Add:
+                slots[op.a] = wrapping_add(slots[op.a], slots[op.b]);
+                touched[op.a] = 1;
+                break;
+            case OpCode::Sub:
+                slots[op.a] = wrapping_subtract(slots[op.a], slots[op.b]);
+                touched[op.a] = 1;
+                break;
+            case OpCode::Mul:
+                slots[op.a] = wrapping_multiply(slots[op.a], slots[op.b]);
+                touched[op.a] = 1;
+                break;
+            case OpCode::Div:
+                slots[op.a] = wrapping_divide(slots[op.a], slots[op.b]);
+                touched[op.a] = 1;
+                break;
+            case OpCode::Jmp:
+                ip = op.a;
+                break;
+            case OpCode::Jnz:
+                ip = (slots[op.b] != 0) ? op.a : ip;
+                break;
+            case OpCode::JnzDynamic:
+                ip = (slots[op.b] != 0) ? bytecode_->relative_jump_target(op.a, slots[op.c]) : ip;
+                break;
+            case OpCode::Cmp:
+                comparison_.set(slots[op.a], slots[op.b]);
+                break;
+            case OpCode::Jne:
+                ip = comparison_.holds(NotEqual) ? op.a : ip;
+                break;
+            case OpCode::Je:
+                ip = comparison_.holds(Equal) ? op.a : ip;
+                break;
+            case OpCode::Jge:
+                ip = comparison_.holds(GreaterOrEqual) ? op.a : ip;
+                break;
+            case OpCode::Jg:
+                ip = comparison_.holds(Greater) ? op.a : ip;
+                break;
+            case OpCode::Jle:
+                ip = comparison_.holds(LessOrEqual) ? op.a : ip;
+                break;
+            case OpCode::Jl:
+                ip = comparison_.holds(Less) ? op.a : ip;
+                break;
+            case OpCode::Call:
+                if (!return_stack_.push(ip))
+                {
+                    preempted_by_ = RunStatus::CallDepthLimit;
+                    ip = end;
+                    break;
+                }
+                hooks.call(op.a);
+                ip = op.a;
+                break;
+            case OpCode::Ret:
+                if (return_stack_.empty())
+                {
+                    ip = end;
+                }
+                else
+                {
+                    hooks.ret();
+                    ip = return_stack_.pop();
+                }
+                break;
+            case OpCode::Msg:
+                write_message(op.a);
+                break;
+            case OpCode::End:
+                ended_ = true;
+                ip = end;
+                break;
+            case OpCode::CmpJne:
+                comparison_.set(slots[op.a], slots[op.b]);
+                ip = (slots[op.a] != slots[op.b]) ? op.c : ip + 1;
+                break;
+            case OpCode::CmpJe:
+                comparison_.set(slots[op.a], slots[op.b]);
+                ip = (slots[op.a] == slots[op.b]) ? op.c : ip + 1;
+                break;
+            case OpCode::CmpJge:
+                comparison_.set(slots[op.a], slots[op.b]);
+                ip = (slots[op.a] >= slots[op.b]) ? op.c : ip + 1;
+                break;
+            case OpCode::CmpJg:
+                comparison_.set(slots[op.a], slots[op.b]);
+                ip = (slots[op.a] > slots[op.b]) ? op.c : ip + 1;
+                break;
+            case OpCode::CmpJle:
+                comparison_.set(slots[op.a], slots[op.b]);
+                ip = (slots[op.a] <= slots[op.b]) ? op.c : ip + 1;
+                break;
+            case OpCode::CmpJl:
+                comparison_.set(slots[op.a], slots[op.b]);
+                ip = (slots[op.a] < slots[op.b]) ? op.c : ip + 1;
+                break;
+            case OpCode::DecJnz:
+                touched[op.a] = 1;
+                slots[op.a] = wrapping_subtract(slots[op.a], Word{1});
+                ip = (slots[op.a] != 0) ? op.c : ip + 1;
+                break;
+            case OpCode::CountedLoop:
+                ip = run_counted_loop(op.a);
+                break;
+            case OpCode::TailCall:
+                hooks.tail_call(op.a);
+                ip = op.a;
+                break;
+        }
+        hooks.retire(executed, op, comparison_.flags());
+        if (ip <= executed && hooks.preempt())
+        {
+            break;
+        }
+    }
 }
 
-std::vector<std::string> get_lines(std::string const& input)
+// Takes the replaced branch, and when the loop goes on runs all its remaining iterations at once. Loops whose
+// trip count cannot be computed, or whose registers would overflow, continue at their head instead and are not
+// counted again until they exit. Trip counts are worked out in 64 bits, machines with wider words only count the
+// loops whose counter, bound and steps fit 32 bits, for which that cannot overflow.
+template <typename Word>
+std::uint32_t BasicMachine<Word>::run_counted_loop(std::uint32_t loop_index)
 {
-    std::vector<std::string> lines;
-    std::istringstream ps(input);
-    for (std::string line; std::getline(ps, line);)
+    auto const& loop{bytecode_->loops[loop_index]};
+    auto const& branch{loop.backedge};
+    if (branch.code == OpCode::DecJnz)
+    {
+        slots_[branch.a] = wrapping_subtract(slots_[branch.a], Word{1});
+        touched_slots_[branch.a] = 1;
+    }
+    else if (branch.code != OpCode::Jnz)
     {
-        ltrim(line);
-        if (line != "")
-            lines.push_back(line);
+        comparison_.set(slots_[branch.a], slots_[branch.b]);
+    }
+    const std::int64_t bound{(loop.relation == OpCode::Jnz) ? 0 : slots_[loop.bound]};
+    if (!loop_continues(loop.relation, slots_[loop.counter], bound))
+    {
+        uncounted_loops_[loop_index] = 0;
+        return loop.exit;
+    }
+    if (uncounted_loops_[loop_index])
+    {
+        return loop.head;
+    }
+    if constexpr (sizeof(Word) > sizeof(std::int32_t))
+    {
+        const auto is_narrow{[](std::int64_t value) {
+            return value >= std::numeric_limits<std::int32_t>::min() &&
+                   value <= std::numeric_limits<std::int32_t>::max();
+        }};
+        const auto is_narrow_slot{[&](Slot slot) { return is_narrow(slots_[slot]); }};
+        bool narrow{is_narrow(slots_[loop.counter]) && is_narrow(bound)};
+        for (auto const& step : loop.steps)
+        {
+            narrow = narrow && is_narrow(step.constant) &&
+                     std::all_of(step.added.begin(), step.added.end(), is_narrow_slot) &&
+                     std::all_of(step.subtracted.begin(), step.subtracted.end(), is_narrow_slot);
+        }
+        if (!narrow)
+        {
+            uncounted_loops_[loop_index] = 1;
+            return loop.head;
+        }
+    }
+
+    const auto delta_of{[this](LoopStep const& step) {
+        auto delta{step.constant};
+        for (auto slot : step.added)
+        {
+            delta = wrapping_add<std::int64_t>(delta, slots_[slot]);
+        }
+        for (auto slot : step.subtracted)
+        {
+            delta = wrapping_subtract<std::int64_t>(delta, slots_[slot]);
+        }
+        return delta;
+    }};
+    const auto trips{
+        remaining_trips(loop.relation, slots_[loop.counter], delta_of(loop.steps[loop.counter_step]), bound)};
+    if (trips == 0)
+    {
+        uncounted_loops_[loop_index] = 1;
+        return loop.head;
+    }
+    // Final value of the slot of step, false when it does not fit a Word. The headroom left in the direction of
+    // the delta is computed modulo 2^64, where it is exact for any Word.
+    const auto final_value{[&](LoopStep const& step, Word& value) {
+        const auto delta{delta_of(step)};
+        const auto start{static_cast<std::uint64_t>(slots_[step.slot])};
+        const auto magnitude{(delta < 0) ? std::uint64_t{0} - static_cast<std::uint64_t>(delta)
+                                         : static_cast<std::uint64_t>(delta)};
+        const auto headroom{(delta < 0) ? start - static_cast<std::uint64_t>(std::numeric_limits<Word>::min())
+                                        : static_cast<std::uint64_t>(std::numeric_limits<Word>::max()) - start};
+        if (magnitude != 0 && static_cast<std::uint64_t>(trips) > headroom / magnitude)
+        {
+            return false;
+        }
+        value = static_cast<Word>(start + static_cast<std::uint64_t>(delta) * static_cast<std::uint64_t>(trips));
+        return true;
+    }};
+    Word value{0};
+    for (auto const& step : loop.steps)
+    {
+        if (!final_value(step, value))
+        {
+            uncounted_loops_[loop_index] = 1;
+            return loop.head;
+        }
+    }
+    for (auto const& step : loop.steps)
+    {
+        final_value(step, slots_[step.slot]);
+        touched_slots_[step.slot] = 1;
+    }
+    if (branch.code != OpCode::Jnz && branch.code != OpCode::DecJnz)
+    {
+        comparison_.set(slots_[branch.a], slots_[branch.b]);
+    }
+    return loop.exit;
+}
+
+template <typename Word>
+void BasicMachine<Word>::write_message(std::uint32_t message)
+{
+    write_message(bytecode_->messages[message]);
+}
+
+template <typename Word>
+void BasicMachine<Word>::write_message(MessageTemplate const& message)
+{
+    message.render(output_, slots_.data());
+    if (sink_ && output_.size() >= sink_chunk_size)
+    {
+        sink_->write(output_);
+        output_.clear();
     }
-    return lines;
 }
 
-void TokenSplitter::parse()
+template <typename Word>
+void BasicMachine<Word>::finish_output()
 {
-    std::regex delimiter(",?\\s+(?=(?:[^']*'[^']*')*[^']*$)");
-    raw_token_ = std::regex_replace(raw_token_, delimiter, "\n");
-    splitup_tokens_ = get_lines(raw_token_);
+    if (!sink_)
+    {
+        return;
+    }
+    if (ended_)
+    {
+        if (!output_.empty())
+        {
+            sink_->write(output_);
+        }
+        sink_->commit();
+    }
+    else
+    {
+        sink_->discard();
+    }
+    output_.clear();
 }
 
-std::vector<std::string> sanitize_raw_program(std::string& raw_program)
+// Output then streams to the sink in chunks of sink_chunk_size instead of staying in the machine, flush only
+// tells whether the program ended. A null sink restores the in memory output.
+template <typename Word>
+void BasicMachine<Word>::set_output_sink(OutputSink* sink)
 {
-    std::vector<std::string> program{get_lines(raw_program)};
-    std::transform(program.begin(), program.end(), program.begin(), [](auto instruction) {
-        std::regex delimiter(";.*(?=(?:[^']*'[^']*')*[^']*$)");
-        return std::regex_replace(instruction, delimiter, "");
-    });
-    program.erase(
-        std::remove_if(program.begin(),
-                       program.end(),
-                       [](auto const& instruction) {
-                           const bool is_only_whitespace{instruction.find_first_not_of(' ') == std::string::npos};
-                           return is_only_whitespace;
-                       }),
-        program.end());
-    return program;
+    sink_ = sink;
+}
+
+// Profiling costs one branch per run while disabled, the engines themselves are left untouched.
+template <typename Word>
+void BasicMachine<Word>::set_profiling(bool enabled)
+{
+    profiling_ = enabled;
+}
+
+template <typename Word>
+Profile const& BasicMachine<Word>::profile() const
+{
+    return profile_;
+}
+
+// Each op a run executes is recorded into trace, which has to outlive the runs. A null trace stops tracing.
+template <typename Word>
+void BasicMachine<Word>::set_trace_buffer(TraceBuffer* trace)
+{
+    trace_ = trace;
+}
+
+template <typename Word>
+void BasicMachine<Word>::reset()
+{
+    seeded_registers_.clear();
+    reset_execution();
+}
+
+// Brings everything a run changes back to its initial state, keeping the allocations of the previous run.
+template <typename Word>
+void BasicMachine<Word>::reset_execution()
+{
+    slots_.assign(bytecode_->initial_slot_values.begin(), bytecode_->initial_slot_values.end());
+    touched_slots_.assign(slots_.size(), 0);
+    for (auto const& seed : seeded_registers_)
+    {
+        slots_[seed.first] = seed.second;
+        touched_slots_[seed.first] = 1;
+    }
+    uncounted_loops_.assign(bytecode_->loops.size(), 0);
+    comparison_ = {};
+    return_stack_.reset(limits_.max_call_depth);
+    output_.clear();
+    ended_ = false;
+    preempted_by_ = RunStatus::Finished;
+    executed_instructions_ = 0;
+}
+
+template <typename Word>
+void BasicMachine<Word>::set_register(std::string const& name, Word value)
+{
+    auto const& names{bytecode_->slot_names};
+    const auto slot{name.empty() ? names.end() : std::find(names.begin(), names.end(), name)};
+    if (slot == names.end())
+    {
+        throw std::out_of_range{"Unknown register " + name};
+    }
+    seeded_registers_.emplace_back(static_cast<Slot>(slot - names.begin()), value);
+}
+
+template <typename Word>
+Word& BasicMachine<Word>::get_register(Slot slot)
+{
+    touched_slots_[slot] = 1;
+    return slots_[slot];
+}
+
+template <typename Word>
+Slot BasicMachine<Word>::operand_slot(std::string_view operand)
+{
+    return slot_table_.operand_slot(std::string{operand});
+}
+
+template <typename Word>
+Slot BasicMachine<Word>::register_slot(std::string_view name)
+{
+    return slot_table_.register_slot(std::string{name});
+}
+
+template <typename Word>
+BasicRegisters<Word> BasicMachine<Word>::get_registers() const
+{
+    BasicRegisters<Word> registers{};
+    auto const& names{bytecode_->slot_names};
+    for (Slot slot{0}; slot < touched_slots_.size(); ++slot)
+    {
+        if (touched_slots_[slot])
+        {
+            registers.emplace(names[slot], slots_[slot]);
+        }
+    }
+    return registers;
+}
+
+// Hands out the output buffer of the last run without copying it, a program that did not end prints -1. The
+// reference stays valid, and flush keeps returning the same output, until the next run or load.
+template <typename Word>
+std::string const& BasicMachine<Word>::flush() const
+{
+    static const std::string unended{"-1"};
+    return ended_ ? output_ : unended;
+}
+
+template <typename Word>
+void BasicMachine<Word>::add_label_reference(std::string_view name)
+{
+    label_map_[name] = ip_;
+}
+
+template <typename Word>
+std::size_t BasicMachine<Word>::label_position(std::string_view name) const
+{
+    return static_cast<std::size_t>(label_map_.at(name) - program_.begin());
+}
+
+template <typename Word>
+void BasicMachine<Word>::enter_subroutine(std::size_t position)
+{
+    if (!return_stack_.push(static_cast<std::uint32_t>(std::distance(program_.begin(), ip_))))
+    {
+        preempted_by_ = RunStatus::CallDepthLimit;
+        ip_ = std::prev(program_.end());
+        return;
+    }
+    jump_to(position);
+}
+
+template <typename Word>
+void BasicMachine<Word>::jump_to(std::size_t position)
+{
+    ip_ = std::next(program_.begin(), static_cast<std::ptrdiff_t>(position));
+}
+
+template <typename Word>
+void BasicMachine<Word>::_return()
+{
+    ip_ = return_stack_.empty() ? std::prev(program_.end()) : std::next(program_.begin(), return_stack_.pop());
+}
+
+template <typename Word>
+void BasicMachine<Word>::set_comparison(Word lhs, Word rhs)
+{
+    comparison_.set(lhs, rhs);
+}
+
+template <typename Word>
+void BasicMachine<Word>::jump_if_flag_is_set(std::size_t position, CmpStatusFlags flag)
+{
+    if (comparison_.holds(flag))
+    {
+        jump_to(position);
+    }
+}
+
+template class InstructionFactory<std::int32_t>;
+template class InstructionFactory<std::int64_t>;
+template class BasicMachine<std::int32_t>;
+template class BasicMachine<std::int64_t>;
+
+template <typename Word>
+BasicRegisters<Word> assembler(RawProgram const& program)
+{
+    BasicMachine<Word> machine{};
+    machine.load_program(program);
+    machine.run_program();
+    return machine.get_registers();
+}
+
+template <typename Word>
+std::string assembler_interpreter(std::string raw_program, ExecutionEngine engine)
+{
+    BasicMachine<Word> machine{};
+    machine.set_engine(engine);
+    machine.load_program(raw_program);
+    machine.run_program();
+    return machine.flush();
+}
+
+template BasicRegisters<std::int32_t> assembler<std::int32_t>(RawProgram const& program);
+template BasicRegisters<std::int64_t> assembler<std::int64_t>(RawProgram const& program);
+template std::string assembler_interpreter<std::int32_t>(std::string raw_program, ExecutionEngine engine);
+template std::string assembler_interpreter<std::int64_t>(std::string raw_program, ExecutionEngine engine);
+
+Registers assembler(RawProgram const& program)
+{
+    return assembler<std::int32_t>(program);
 }
 
 std::string assembler_interpreter(std::string raw_program)
 {
-    auto program{sanitize_raw_program(raw_program)};
+    return assembler_interpreter(std::move(raw_program), ExecutionEngine::Threaded);
+}
+
+std::string assembler_interpreter(std::string raw_program, ExecutionEngine engine)
+{
+    return assembler_interpreter<std::int32_t>(std::move(raw_program), engine);
+}
+
+std::string assembler_interpreter(std::string const& raw_program, ProgramCache& cache)
+{
     Machine machine{};
-    machine.load_program(program);
+    machine.load_program(cache.get(raw_program));
     machine.run_program();
     return machine.flush();
 }
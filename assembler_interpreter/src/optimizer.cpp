@@ -0,0 +1,986 @@
+#include "assembler_interpreter/src/optimizer.h"
+#include <algorithm>
+#include <limits>
+#include <string>
+#include <unordered_map>
+#include "assembler_interpreter/src/control_flow.h"
+
+namespace
+{
+bool fuse_compare_jump(OpCode jump, OpCode& fused)
+{
+    switch (jump)
+    {
+        case OpCode::Jne:
+            fused = OpCode::CmpJne;
+            return true;
+        case OpCode::Je:
+            fused = OpCode::CmpJe;
+            return true;
+        case OpCode::Jge:
+            fused = OpCode::CmpJge;
+            return true;
+        case OpCode::Jg:
+            fused = OpCode::CmpJg;
+            return true;
+        case OpCode::Jle:
+            fused = OpCode::CmpJle;
+            return true;
+        case OpCode::Jl:
+            fused = OpCode::CmpJl;
+            return true;
+        default:
+            return false;
+    }
+}
+
+OpCode mirrored(OpCode relation)
+{
+    switch (relation)
+    {
+        case OpCode::CmpJge:
+            return OpCode::CmpJle;
+        case OpCode::CmpJg:
+            return OpCode::CmpJl;
+        case OpCode::CmpJle:
+            return OpCode::CmpJge;
+        case OpCode::CmpJl:
+            return OpCode::CmpJg;
+        default:
+            return relation;
+    }
+}
+
+bool is_compare_jump(OpCode code)
+{
+    return code >= OpCode::CmpJne && code <= OpCode::CmpJl;
+}
+
+LoopStep& step_of(std::vector<LoopStep>& steps, Slot slot)
+{
+    const auto step{std::find_if(steps.begin(), steps.end(), [slot](auto const& step) { return step.slot == slot; })};
+    if (step != steps.end())
+    {
+        return *step;
+    }
+    steps.push_back({slot});
+    return steps.back();
+}
+
+bool is_written(std::vector<LoopStep> const& steps, Slot slot)
+{
+    return std::any_of(steps.begin(), steps.end(), [slot](auto const& step) { return step.slot == slot; });
+}
+
+// Steps of 64 bit machines can add up to more than a word holds, they wrap around the way the registers do.
+void add_constant(LoopStep& step, std::int64_t value)
+{
+    step.constant = wrapping_add(step.constant, value);
+}
+
+void add_term(Bytecode const& bytecode, LoopStep& step, Slot source, bool subtract)
+{
+    if (bytecode.is_constant(source))
+    {
+        const std::int64_t value{bytecode.initial_slot_values[source]};
+        add_constant(step, subtract ? wrapping_subtract(std::int64_t{0}, value) : value);
+    }
+    else
+    {
+        (subtract ? step.subtracted : step.added).push_back(source);
+    }
+}
+
+// Describes the loop closed by the branch at index, if its body only increments, decrements, adds and subtracts.
+bool recognize_loop(Bytecode const& bytecode, std::uint32_t index, CountedLoop& loop)
+{
+    auto const& code{bytecode.code};
+    auto const& branch{code[index]};
+    loop.backedge = branch;
+    switch (branch.code)
+    {
+        case OpCode::Jnz:
+            loop.head = branch.a;
+            loop.exit = index + 1;
+            break;
+        case OpCode::DecJnz:
+            add_constant(step_of(loop.steps, branch.a), -1);
+            loop.head = branch.c;
+            loop.exit = index + 2;
+            break;
+        default:
+            if (!is_compare_jump(branch.code))
+            {
+                return false;
+            }
+            loop.head = branch.c;
+            loop.exit = index + 2;
+            break;
+    }
+    if (loop.head > index)
+    {
+        return false;
+    }
+
+    for (auto body{loop.head}; body < index; ++body)
+    {
+        auto const& op{code[body]};
+        switch (op.code)
+        {
+            case OpCode::Inc:
+                add_constant(step_of(loop.steps, op.a), 1);
+                break;
+            case OpCode::Dec:
+                add_constant(step_of(loop.steps, op.a), -1);
+                break;
+            case OpCode::Add:
+            case OpCode::Sub:
+                add_term(bytecode, step_of(loop.steps, op.a), op.b, op.code == OpCode::Sub);
+                break;
+            default:
+                return false;
+        }
+    }
+    for (auto const& step : loop.steps)
+    {
+        const auto is_variant{[&loop](Slot slot) { return is_written(loop.steps, slot); }};
+        if (std::any_of(step.added.begin(), step.added.end(), is_variant) ||
+            std::any_of(step.subtracted.begin(), step.subtracted.end(), is_variant))
+        {
+            return false;
+        }
+    }
+
+    if (branch.code == OpCode::Jnz || branch.code == OpCode::DecJnz)
+    {
+        loop.relation = OpCode::Jnz;
+        loop.counter = (branch.code == OpCode::Jnz) ? branch.b : branch.a;
+    }
+    else if (is_written(loop.steps, branch.a) && !is_written(loop.steps, branch.b))
+    {
+        loop.relation = branch.code;
+        loop.counter = branch.a;
+        loop.bound = branch.b;
+    }
+    else if (is_written(loop.steps, branch.b) && !is_written(loop.steps, branch.a))
+    {
+        loop.relation = mirrored(branch.code);
+        loop.counter = branch.b;
+        loop.bound = branch.a;
+    }
+    else
+    {
+        return false;
+    }
+    const auto counter{std::find_if(loop.steps.begin(), loop.steps.end(),
+                                    [&loop](auto const& step) { return step.slot == loop.counter; })};
+    if (counter == loop.steps.end())
+    {
+        return false;
+    }
+    loop.counter_step = static_cast<std::size_t>(counter - loop.steps.begin());
+    return true;
+}
+
+std::int64_t trips_until_equal(std::int64_t counter, std::int64_t step, std::int64_t bound)
+{
+    if (step == 0 || (bound - counter) % step != 0)
+    {
+        return 0;
+    }
+    return std::max<std::int64_t>((bound - counter) / step, 0);
+}
+
+// What propagation knows of a value at some point of the program. Points it did not reach yet know nothing,
+// varying values may differ between runs or between the paths leading there.
+enum class Knowledge : std::uint8_t
+{
+    Unreached,
+    Constant,
+    Varying
+};
+
+struct Value
+{
+    Knowledge knowledge{Knowledge::Unreached};
+    SlotValue value{0};
+};
+
+// Outcome of the last comparison as -1, 0 or 1 for less, equal and greater, or not_compared before the first.
+constexpr SlotValue not_compared{2};
+
+struct DataflowState
+{
+    std::vector<Value> slots{};
+    Value ordering{};
+};
+
+// Slots a subroutine may write between being called and returning, and whether it may compare.
+struct Clobbers
+{
+    std::vector<std::uint8_t> slots{};
+    bool comparison{false};
+};
+
+constexpr std::uint32_t unresolved{std::numeric_limits<std::uint32_t>::max()};
+
+Value constant(SlotValue value)
+{
+    return {Knowledge::Constant, value};
+}
+
+Value varying()
+{
+    return {Knowledge::Varying, 0};
+}
+
+// Result of the arithmetic op code on two words, as the engines of a machine with that word size compute it.
+// Results that wrap around, and divisions by zero, stay varying.
+template <typename Word>
+Value folded(OpCode code, Word lhs, Word rhs)
+{
+    switch (code)
+    {
+        case OpCode::Add:
+        {
+            const auto sum{wrapping_add(lhs, rhs)};
+            return ((rhs < 0) == (sum < lhs)) ? constant(sum) : varying();
+        }
+        case OpCode::Sub:
+        {
+            const auto difference{wrapping_subtract(lhs, rhs)};
+            return ((rhs < 0) == (difference > lhs)) ? constant(difference) : varying();
+        }
+        case OpCode::Mul:
+        {
+            if (lhs == -1 && rhs == std::numeric_limits<Word>::min())
+            {
+                return varying();
+            }
+            const auto product{wrapping_multiply(lhs, rhs)};
+            return (lhs == 0 || product / lhs == rhs) ? constant(product) : varying();
+        }
+        default:
+            if (rhs == 0 || (rhs == -1 && lhs == std::numeric_limits<Word>::min()))
+            {
+                return varying();
+            }
+            return constant(lhs / rhs);
+    }
+}
+
+bool merge(Value& into, Value const& from)
+{
+    if (from.knowledge == Knowledge::Unreached || into.knowledge == Knowledge::Varying)
+    {
+        return false;
+    }
+    if (into.knowledge == Knowledge::Unreached)
+    {
+        into = from;
+        return true;
+    }
+    if (from.knowledge == Knowledge::Varying || from.value != into.value)
+    {
+        into = varying();
+        return true;
+    }
+    return false;
+}
+
+bool merge(DataflowState& into, DataflowState const& from)
+{
+    if (into.slots.empty())
+    {
+        into = from;
+        return true;
+    }
+    bool changed{merge(into.ordering, from.ordering)};
+    for (std::size_t slot{0}; slot < into.slots.size(); ++slot)
+    {
+        changed = merge(into.slots[slot], from.slots[slot]) || changed;
+    }
+    return changed;
+}
+
+bool is_fused(OpCode code)
+{
+    return is_compare_jump(code) || code == OpCode::DecJnz;
+}
+
+bool writes_slot(Op const& op)
+{
+    return (op.code >= OpCode::Mov && op.code <= OpCode::Div) || op.code == OpCode::DecJnz;
+}
+
+bool writes_comparison(Op const& op)
+{
+    return op.code == OpCode::Cmp || is_compare_jump(op.code);
+}
+
+bool reads_comparison(Op const& op)
+{
+    return (op.code >= OpCode::Jne && op.code <= OpCode::Jl) || op.code == OpCode::Ret;
+}
+
+template <typename Word>
+Value result_of(Op const& op, DataflowState const& state)
+{
+    auto const& target{state.slots[op.a]};
+    auto const& source{state.slots[op.b]};
+    if (op.code == OpCode::Mov)
+    {
+        return source;
+    }
+    if (target.knowledge != Knowledge::Constant)
+    {
+        return varying();
+    }
+    const auto lhs{static_cast<Word>(target.value)};
+    if (op.code == OpCode::Inc)
+    {
+        return folded(OpCode::Add, lhs, Word{1});
+    }
+    if (op.code == OpCode::Dec || op.code == OpCode::DecJnz)
+    {
+        return folded(OpCode::Sub, lhs, Word{1});
+    }
+    if (source.knowledge != Knowledge::Constant)
+    {
+        return varying();
+    }
+    return folded(op.code, lhs, static_cast<Word>(source.value));
+}
+
+template <typename Word>
+void apply(Op const& op, DataflowState& state)
+{
+    if (writes_slot(op))
+    {
+        state.slots[op.a] = result_of<Word>(op, state);
+    }
+    if (writes_comparison(op))
+    {
+        auto const& lhs{state.slots[op.a]};
+        auto const& rhs{state.slots[op.b]};
+        const bool is_known{lhs.knowledge == Knowledge::Constant && rhs.knowledge == Knowledge::Constant};
+        state.ordering = is_known ? constant((lhs.value < rhs.value) ? -1 : (lhs.value > rhs.value) ? 1 : 0)
+                                  : varying();
+    }
+}
+
+std::uint32_t jump_target(Op const& op)
+{
+    return is_fused(op.code) ? op.c : op.a;
+}
+
+std::uint32_t fall_through(Op const& op, std::uint32_t index)
+{
+    return is_fused(op.code) ? index + 2 : index + 1;
+}
+
+// Whether the conditional branch op always goes the same way given the state after it ran, and which.
+bool is_decided(Op const& op, DataflowState const& state, bool& taken)
+{
+    if (op.code == OpCode::Jnz || op.code == OpCode::DecJnz)
+    {
+        auto const& condition{state.slots[(op.code == OpCode::Jnz) ? op.b : op.a]};
+        taken = condition.value != 0;
+        return condition.knowledge == Knowledge::Constant;
+    }
+    OpCode relation{op.code};
+    if (!is_compare_jump(op.code) && !fuse_compare_jump(op.code, relation))
+    {
+        return false;
+    }
+    taken = state.ordering.value != not_compared && loop_continues(relation, state.ordering.value, 0);
+    return state.ordering.knowledge == Knowledge::Constant;
+}
+
+Clobbers clobbers_of(Bytecode const& bytecode, ControlFlowGraph const& graph, std::uint32_t callee)
+{
+    auto const& blocks{graph.blocks()};
+    Clobbers clobbers{std::vector<std::uint8_t>(bytecode.slot_count(), 0)};
+    std::vector<std::uint8_t> visited(blocks.size(), 0);
+    std::vector<std::uint32_t> pending{graph.block_of(callee)};
+    visited[pending.back()] = 1;
+    while (!pending.empty())
+    {
+        auto const& block{blocks[pending.back()]};
+        pending.pop_back();
+        for (auto index{block.begin}; index < block.end; ++index)
+        {
+            auto const& op{bytecode.code[index]};
+            if (writes_slot(op))
+            {
+                clobbers.slots[op.a] = 1;
+            }
+            clobbers.comparison = clobbers.comparison || writes_comparison(op);
+        }
+        for (auto successor : block.successors)
+        {
+            if (!visited[successor])
+            {
+                visited[successor] = 1;
+                pending.push_back(successor);
+            }
+        }
+    }
+    return clobbers;
+}
+
+// States on entry to each block, unreached blocks keep an empty one.
+template <typename Word>
+std::vector<DataflowState> propagate_states(Bytecode const& bytecode, ControlFlowGraph const& graph)
+{
+    auto const& code{bytecode.code};
+    auto const& blocks{graph.blocks()};
+    const auto size{static_cast<std::uint32_t>(code.size())};
+    std::vector<DataflowState> states(blocks.size());
+    std::vector<std::uint8_t> pending_blocks(blocks.size(), 0);
+    std::vector<std::uint32_t> pending{};
+    std::unordered_map<std::uint32_t, Clobbers> subroutines{};
+    const auto send{[&](std::uint32_t index, DataflowState const& state) {
+        if (index >= size)
+        {
+            return;
+        }
+        const auto block{graph.block_of(index)};
+        if (merge(states[block], state) && !pending_blocks[block])
+        {
+            pending_blocks[block] = 1;
+            pending.push_back(block);
+        }
+    }};
+
+    DataflowState entry{std::vector<Value>(bytecode.slot_count()), constant(not_compared)};
+    for (Slot slot{0}; slot < entry.slots.size(); ++slot)
+    {
+        entry.slots[slot] = bytecode.is_constant(slot) ? constant(bytecode.initial_slot_values[slot]) : varying();
+    }
+    send(0, entry);
+    while (!pending.empty())
+    {
+        const auto block_index{pending.back()};
+        pending.pop_back();
+        pending_blocks[block_index] = 0;
+        auto const& block{blocks[block_index]};
+        auto state{states[block_index]};
+        for (auto index{block.begin}; index < block.end; ++index)
+        {
+            apply<Word>(code[index], state);
+        }
+
+        const auto last{block.end - 1};
+        auto const& op{code[last]};
+        bool taken{false};
+        if (op.code == OpCode::Call)
+        {
+            if (op.a >= size)
+            {
+                continue;
+            }
+            send(op.a, state);
+            auto subroutine{subroutines.find(op.a)};
+            if (subroutine == subroutines.end())
+            {
+                subroutine = subroutines.emplace(op.a, clobbers_of(bytecode, graph, op.a)).first;
+            }
+            auto const& clobbers{subroutine->second};
+            for (Slot slot{0}; slot < state.slots.size(); ++slot)
+            {
+                state.slots[slot] = clobbers.slots[slot] ? varying() : state.slots[slot];
+            }
+            state.ordering = clobbers.comparison ? varying() : state.ordering;
+            send(last + 1, state);
+        }
+        else if (is_decided(op, state, taken))
+        {
+            send(taken ? jump_target(op) : fall_through(op, last), state);
+        }
+        else
+        {
+            for (auto successor : block.successors)
+            {
+                send(blocks[successor].begin, state);
+            }
+        }
+    }
+    return states;
+}
+
+Slot constant_slot(Bytecode& bytecode, SlotValue value)
+{
+    for (Slot slot{0}; slot < bytecode.slot_count(); ++slot)
+    {
+        if (bytecode.is_constant(slot) && bytecode.initial_slot_values[slot] == value)
+        {
+            return slot;
+        }
+    }
+    bytecode.slot_names.emplace_back();
+    bytecode.initial_slot_values.push_back(value);
+    return static_cast<Slot>(bytecode.slot_count() - 1);
+}
+
+void fold_message(MessageTemplate& message, DataflowState const& state)
+{
+    MessageTemplate folded_message{};
+    bool is_folded{false};
+    for (auto const& segment : message.segments())
+    {
+        if (!segment.text.empty())
+        {
+            folded_message.add_text(segment.text);
+        }
+        if (!segment.has_value)
+        {
+            continue;
+        }
+        auto const& value{state.slots[segment.slot]};
+        if (value.knowledge == Knowledge::Constant)
+        {
+            folded_message.add_text(std::to_string(value.value));
+            is_folded = true;
+        }
+        else
+        {
+            folded_message.add_value(segment.slot);
+        }
+    }
+    if (is_folded)
+    {
+        message = std::move(folded_message);
+    }
+}
+
+// Rewrites the ops of every reached block given its entry state. Returns for each op comparing known values
+// where execution goes on after it, so that it can be replaced by a jump once nothing reads its flags.
+template <typename Word>
+std::vector<std::uint32_t> fold_blocks(Bytecode& bytecode, ControlFlowGraph const& graph,
+                                       std::vector<DataflowState> const& states)
+{
+    auto& code{bytecode.code};
+    std::vector<std::uint32_t> resolved(code.size(), unresolved);
+    for (std::size_t block_index{0}; block_index < states.size(); ++block_index)
+    {
+        if (states[block_index].slots.empty())
+        {
+            continue;
+        }
+        auto const& block{graph.blocks()[block_index]};
+        auto state{states[block_index]};
+        for (auto index{block.begin}; index < block.end; ++index)
+        {
+            const auto op{code[index]};
+            apply<Word>(op, state);
+            bool taken{false};
+            if (op.code == OpCode::Msg)
+            {
+                fold_message(bytecode.messages[op.a], state);
+            }
+            else if (op.code == OpCode::Cmp && state.ordering.knowledge == Knowledge::Constant)
+            {
+                resolved[index] = index + 1;
+            }
+            else if (is_compare_jump(op.code) && is_decided(op, state, taken))
+            {
+                resolved[index] = taken ? op.c : index + 2;
+            }
+            else if (op.code != OpCode::DecJnz && is_decided(op, state, taken))
+            {
+                code[index] = {OpCode::Jmp, taken ? op.a : index + 1};
+            }
+            else if (op.code != OpCode::DecJnz && writes_slot(op) &&
+                     state.slots[op.a].knowledge == Knowledge::Constant &&
+                     !(op.code == OpCode::Mov && bytecode.is_constant(op.b)))
+            {
+                code[index] = {OpCode::Mov, op.a, constant_slot(bytecode, state.slots[op.a].value)};
+            }
+        }
+    }
+    return resolved;
+}
+
+// Replaces the resolved comparisons whose flags no conditional jump can read by jumps. A ret may hand the flags
+// back to the caller, which is where they are read for all this pass knows.
+void drop_unread_comparisons(Bytecode& bytecode, std::vector<std::uint32_t> const& resolved)
+{
+    auto& code{bytecode.code};
+    const ControlFlowGraph graph{bytecode};
+    auto const& blocks{graph.blocks()};
+    std::vector<std::uint8_t> live_in(blocks.size(), 0);
+    const auto live_out{[&](BasicBlock const& block) {
+        return std::any_of(block.successors.begin(), block.successors.end(),
+                           [&live_in](auto successor) { return live_in[successor] != 0; });
+    }};
+    const auto live_before{[](Op const& op, bool live) {
+        return reads_comparison(op) || (live && !writes_comparison(op));
+    }};
+
+    for (bool changed{true}; changed;)
+    {
+        changed = false;
+        for (auto block_index{blocks.size()}; block_index-- > 0;)
+        {
+            auto const& block{blocks[block_index]};
+            bool live{live_out(block)};
+            for (auto index{block.end}; index-- > block.begin;)
+            {
+                live = live_before(code[index], live);
+            }
+            if (live && !live_in[block_index])
+            {
+                live_in[block_index] = 1;
+                changed = true;
+            }
+        }
+    }
+    for (auto const& block : blocks)
+    {
+        bool live{live_out(block)};
+        for (auto index{block.end}; index-- > block.begin;)
+        {
+            if (!live && resolved[index] != unresolved)
+            {
+                code[index] = {OpCode::Jmp, resolved[index]};
+            }
+            live = live_before(code[index], live);
+        }
+    }
+}
+
+// Removes unreachable ops and jumps to where execution would go on anyway, and moves every code index onto the
+// op that remains in place of the one it pointed at. The op behind a fused one stays as long as that one does.
+std::size_t remove_dead_ops(Bytecode& bytecode)
+{
+    auto& code{bytecode.code};
+    const auto size{static_cast<std::uint32_t>(code.size())};
+    const ControlFlowGraph graph{bytecode};
+    const auto reachable_blocks{graph.reachable_blocks()};
+    const auto is_reachable{[&](std::uint32_t index) { return reachable_blocks[graph.block_of(index)]; }};
+
+    std::vector<std::uint32_t> next_kept(size + 1, size);
+    for (auto index{size}; index-- > 0;)
+    {
+        auto const& op{code[index]};
+        const bool is_skipped{op.code == OpCode::Jmp && op.a > index && next_kept[index + 1] == next_kept[op.a]};
+        const bool is_absorbed{index > 0 && is_fused(code[index - 1].code) && is_reachable(index - 1)};
+        next_kept[index] = ((is_reachable(index) && !is_skipped) || is_absorbed) ? index : next_kept[index + 1];
+    }
+    std::vector<std::uint32_t> new_index(size + 1, 0);
+    std::vector<Op> kept{};
+    for (std::uint32_t index{0}; index < size; ++index)
+    {
+        new_index[index] = static_cast<std::uint32_t>(kept.size());
+        if (next_kept[index] == index)
+        {
+            kept.push_back(code[index]);
+        }
+    }
+    new_index[size] = static_cast<std::uint32_t>(kept.size());
+
+    const auto moved{[&](std::uint32_t target) { return new_index[next_kept[target]]; }};
+    for (auto& op : kept)
+    {
+        switch (op.code)
+        {
+            case OpCode::Jmp:
+            case OpCode::Jnz:
+            case OpCode::Jne:
+            case OpCode::Je:
+            case OpCode::Jge:
+            case OpCode::Jg:
+            case OpCode::Jle:
+            case OpCode::Jl:
+            case OpCode::Call:
+            case OpCode::TailCall:
+                op.a = moved(op.a);
+                break;
+            default:
+                op.c = is_fused(op.code) ? moved(op.c) : op.c;
+                break;
+        }
+    }
+    for (auto& target : bytecode.source_to_code)
+    {
+        target = moved(target);
+    }
+    code = std::move(kept);
+    return size - code.size();
+}
+
+bool leaves_program(Op const& op, std::uint32_t index, std::uint32_t size)
+{
+    switch (op.code)
+    {
+        case OpCode::End:
+        case OpCode::Ret:
+            return true;
+        case OpCode::Jmp:
+        case OpCode::Call:
+        case OpCode::TailCall:
+            return op.a >= size;
+        case OpCode::Jnz:
+        case OpCode::Jne:
+        case OpCode::Je:
+        case OpCode::Jge:
+        case OpCode::Jg:
+        case OpCode::Jle:
+        case OpCode::Jl:
+            return op.a >= size || index + 1 >= size;
+        default:
+            return (is_fused(op.code) && op.c >= size) || fall_through(op, index) >= size;
+    }
+}
+
+template <typename Function>
+void for_each_read(Bytecode const& bytecode, Op const& op, Function read)
+{
+    switch (op.code)
+    {
+        case OpCode::Mov:
+        case OpCode::Jnz:
+            read(op.b);
+            break;
+        case OpCode::Inc:
+        case OpCode::Dec:
+        case OpCode::DecJnz:
+            read(op.a);
+            break;
+        case OpCode::Msg:
+            for (auto const& segment : bytecode.messages[op.a].segments())
+            {
+                if (segment.has_value)
+                {
+                    read(segment.slot);
+                }
+            }
+            break;
+        default:
+            if ((op.code >= OpCode::Add && op.code <= OpCode::Div) || writes_comparison(op))
+            {
+                read(op.a);
+                read(op.b);
+            }
+            break;
+    }
+}
+
+// A write without a reader can only go if the op has no other effect, a division by zero can trap.
+bool is_removable_write(Bytecode const& bytecode, Op const& op)
+{
+    if (op.code == OpCode::Div)
+    {
+        const auto divisor{bytecode.initial_slot_values[op.b]};
+        return bytecode.is_constant(op.b) && divisor != 0;
+    }
+    return op.code >= OpCode::Mov && op.code <= OpCode::Mul;
+}
+
+void transfer_liveness(Bytecode const& bytecode, Op const& op, std::vector<std::uint8_t>& live)
+{
+    if (writes_slot(op))
+    {
+        live[op.a] = 0;
+    }
+    for_each_read(bytecode, op, [&live](Slot slot) { live[slot] = 1; });
+}
+
+// Replaces the writes nothing reads afterwards by jumps to the next op, returns whether there were any. Registers
+// are live at the end of a run when they are observed. What is live behind a call is live at every ret, a call
+// only passes on what its subroutine reads.
+bool drop_dead_writes(Bytecode& bytecode, bool registers_observed)
+{
+    auto& code{bytecode.code};
+    const auto size{static_cast<std::uint32_t>(code.size())};
+    const ControlFlowGraph graph{bytecode};
+    auto const& blocks{graph.blocks()};
+    std::vector<std::vector<std::uint8_t>> live_in(blocks.size(), std::vector<std::uint8_t>(bytecode.slot_count(), 0));
+    std::vector<std::uint32_t> return_sites{};
+    for (std::uint32_t index{0}; index + 1 < size; ++index)
+    {
+        if (code[index].code == OpCode::Call)
+        {
+            return_sites.push_back(graph.block_of(index + 1));
+        }
+    }
+
+    const auto live_out{[&](BasicBlock const& block) {
+        const auto last{block.end - 1};
+        std::vector<std::uint8_t> live(bytecode.slot_count(), 0);
+        const auto add{[&live](std::vector<std::uint8_t> const& successor) {
+            std::transform(live.begin(), live.end(), successor.begin(), live.begin(),
+                           [](auto lhs, auto rhs) { return lhs | rhs; });
+        }};
+        if (registers_observed && leaves_program(code[last], last, size))
+        {
+            std::fill(live.begin(), live.end(), 1);
+        }
+        for (auto successor : block.successors)
+        {
+            if (code[last].code != OpCode::Call || blocks[successor].begin == code[last].a)
+            {
+                add(live_in[successor]);
+            }
+        }
+        if (code[last].code == OpCode::Ret)
+        {
+            for (auto site : return_sites)
+            {
+                add(live_in[site]);
+            }
+        }
+        return live;
+    }};
+
+    for (bool changed{true}; changed;)
+    {
+        changed = false;
+        for (auto block_index{blocks.size()}; block_index-- > 0;)
+        {
+            auto const& block{blocks[block_index]};
+            auto live{live_out(block)};
+            for (auto index{block.end}; index-- > block.begin;)
+            {
+                transfer_liveness(bytecode, code[index], live);
+            }
+            if (live != live_in[block_index])
+            {
+                live_in[block_index] = std::move(live);
+                changed = true;
+            }
+        }
+    }
+
+    bool dropped{false};
+    for (auto const& block : blocks)
+    {
+        auto live{live_out(block)};
+        for (auto index{block.end}; index-- > block.begin;)
+        {
+            auto const& op{code[index]};
+            if (writes_slot(op) && !live[op.a] && is_removable_write(bytecode, op))
+            {
+                code[index] = {OpCode::Jmp, index + 1};
+                dropped = true;
+            }
+            transfer_liveness(bytecode, code[index], live);
+        }
+    }
+    return dropped;
+}
+}  // namespace
+
+void fuse_superinstructions(Bytecode& bytecode)
+{
+    auto& code{bytecode.code};
+    for (std::size_t index{0}; index + 1 < code.size(); ++index)
+    {
+        auto& first{code[index]};
+        auto const& second{code[index + 1]};
+        OpCode fused{};
+        if (first.code == OpCode::Cmp && fuse_compare_jump(second.code, fused))
+        {
+            first = {fused, first.a, first.b, second.a};
+        }
+        else if (first.code == OpCode::Dec && second.code == OpCode::Jnz && second.b == first.a)
+        {
+            first = {OpCode::DecJnz, first.a, 0, second.a};
+        }
+    }
+}
+
+void collapse_counting_loops(Bytecode& bytecode)
+{
+    auto& code{bytecode.code};
+    for (std::uint32_t index{0}; index < code.size(); ++index)
+    {
+        CountedLoop loop{};
+        if (recognize_loop(bytecode, index, loop))
+        {
+            code[index] = {OpCode::CountedLoop, static_cast<std::uint32_t>(bytecode.loops.size())};
+            bytecode.loops.push_back(std::move(loop));
+        }
+    }
+}
+
+void eliminate_tail_calls(Bytecode& bytecode)
+{
+    auto& code{bytecode.code};
+    for (std::size_t index{0}; index + 1 < code.size(); ++index)
+    {
+        if (code[index].code == OpCode::Call && code[index + 1].code == OpCode::Ret)
+        {
+            code[index].code = OpCode::TailCall;
+        }
+    }
+}
+
+template <typename Word>
+std::size_t propagate_constants(Bytecode& bytecode)
+{
+    const ControlFlowGraph graph{bytecode};
+    if (graph.has_dynamic_jumps() || !bytecode.loops.empty() || bytecode.code.empty())
+    {
+        return 0;
+    }
+    const auto states{propagate_states<Word>(bytecode, graph)};
+    const auto resolved{fold_blocks<Word>(bytecode, graph, states)};
+    drop_unread_comparisons(bytecode, resolved);
+    return remove_dead_ops(bytecode);
+}
+
+template std::size_t propagate_constants<std::int32_t>(Bytecode& bytecode);
+template std::size_t propagate_constants<std::int64_t>(Bytecode& bytecode);
+
+std::size_t eliminate_dead_code(Bytecode& bytecode, bool registers_observed)
+{
+    const ControlFlowGraph graph{bytecode};
+    if (graph.has_dynamic_jumps() || !bytecode.loops.empty() || bytecode.code.empty())
+    {
+        return 0;
+    }
+    while (drop_dead_writes(bytecode, registers_observed))
+    {
+    }
+    return remove_dead_ops(bytecode);
+}
+
+bool loop_continues(OpCode relation, std::int64_t counter, std::int64_t bound)
+{
+    switch (relation)
+    {
+        case OpCode::CmpJe:
+            return counter == bound;
+        case OpCode::CmpJge:
+            return counter >= bound;
+        case OpCode::CmpJg:
+            return counter > bound;
+        case OpCode::CmpJle:
+            return counter <= bound;
+        case OpCode::CmpJl:
+            return counter < bound;
+        default:
+            return counter != bound;
+    }
+}
+
+std::int64_t remaining_trips(OpCode relation, std::int64_t counter, std::int64_t step, std::int64_t bound)
+{
+    switch (relation)
+    {
+        case OpCode::CmpJe:
+            return (step == 0) ? 0 : 1;
+        case OpCode::CmpJge:
+            return (step >= 0) ? 0 : (counter - bound) / -step + 1;
+        case OpCode::CmpJg:
+            return (step >= 0) ? 0 : (counter - bound - step - 1) / -step;
+        case OpCode::CmpJle:
+            return (step <= 0) ? 0 : (bound - counter) / step + 1;
+        case OpCode::CmpJl:
+            return (step <= 0) ? 0 : (bound - counter + step - 1) / step;
+        default:
+            return trips_until_equal(counter, step, bound);
+    }
+}
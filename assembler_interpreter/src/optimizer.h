@@ -0,0 +1,40 @@
+#ifndef OPTIMIZER_H
+#define OPTIMIZER_H
+
+#include <cstddef>
+#include <cstdint>
+#include "assembler_interpreter/src/bytecode.h"
+
+// Replaces cmp + jcc and dec + jnz pairs by single compare-and-branch and decrement-and-branch ops.
+void fuse_superinstructions(Bytecode& bytecode);
+
+// Replaces the branch closing each loop with an affine body by a CountedLoop op, which applies all remaining
+// iterations at once when their number can be computed. Runs after fuse_superinstructions.
+void collapse_counting_loops(Bytecode& bytecode);
+
+// Replaces each call directly followed by a ret by a TailCall op, which jumps to the callee without pushing a
+// return address. The ret stays for the jumps landing on it.
+void eliminate_tail_calls(Bytecode& bytecode);
+
+// Folds the values registers are known to hold at load time into the ops using them: arithmetic with a known
+// result becomes a mov of that result, msg arguments with known values become text and branches decided at load
+// time become jumps or disappear, together with the comparisons only they read and the code nothing reaches any
+// more. Registers are unknown on entry since a machine can seed them before each run, a call leaves the ones its
+// subroutine writes unknown. Results are folded in the words of the machine running the program and only where
+// they do not overflow. Programs with dynamic jumps are left as they are. Runs after eliminate_tail_calls and
+// before collapse_counting_loops, returns the number of ops removed. Instantiated for std::int32_t and std::int64_t.
+template <typename Word>
+std::size_t propagate_constants(Bytecode& bytecode);
+
+// Removes the ops no run reaches, jumps to where execution goes on anyway and writes to registers that no later
+// op reads. With registers_observed the values registers end a run with count as read. Programs with dynamic
+// jumps are left as they are. Runs before collapse_counting_loops, returns the number of ops removed.
+std::size_t eliminate_dead_code(Bytecode& bytecode, bool registers_observed);
+
+bool loop_continues(OpCode relation, std::int64_t counter, std::int64_t bound);
+
+// Number of further iterations until `counter relation bound` fails, the counter changing by step in each of
+// them. Zero when the loop would not terminate before the counter overflows.
+std::int64_t remaining_trips(OpCode relation, std::int64_t counter, std::int64_t step, std::int64_t bound);
+
+#endif /* OPTIMIZER_H */
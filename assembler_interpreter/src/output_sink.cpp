@@ -0,0 +1,158 @@
+#include "assembler_interpreter/src/output_sink.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <system_error>
+#include <utility>
+#include <unistd.h>
+
+CallbackSink::CallbackSink(Writer writer, Finisher finisher)
+    : writer_{std::move(writer)}, finisher_{std::move(finisher)}
+{
+}
+
+void CallbackSink::write(std::string_view text)
+{
+    writer_(text);
+}
+
+void CallbackSink::commit()
+{
+    if (finisher_)
+    {
+        finisher_(true);
+    }
+}
+
+void CallbackSink::discard()
+{
+    if (finisher_)
+    {
+        finisher_(false);
+    }
+}
+
+FileDescriptorSink::FileDescriptorSink(int fd) : fd_{fd} {}
+
+void FileDescriptorSink::write(std::string_view text)
+{
+    if (!in_run_)
+    {
+        begin_run();
+    }
+    write_all(text);
+}
+
+void FileDescriptorSink::commit()
+{
+    in_run_ = false;
+}
+
+void FileDescriptorSink::discard()
+{
+    if (!in_run_)
+    {
+        begin_run();
+    }
+    in_run_ = false;
+    if (run_start_ >= 0 && ::ftruncate(fd_, run_start_) == 0)
+    {
+        ::lseek(fd_, run_start_, SEEK_SET);
+    }
+    write_all("-1");
+}
+
+void FileDescriptorSink::begin_run()
+{
+    run_start_ = ::lseek(fd_, 0, SEEK_CUR);
+    in_run_ = true;
+}
+
+void FileDescriptorSink::write_all(std::string_view text)
+{
+    while (!text.empty())
+    {
+        const auto written{::write(fd_, text.data(), text.size())};
+        if (written < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            throw std::system_error{errno, std::generic_category(), "Cannot write program output"};
+        }
+        text.remove_prefix(static_cast<std::size_t>(written));
+    }
+}
+
+RingBufferSink::RingBufferSink(std::size_t capacity) : buffer_(capacity, '\0') {}
+
+void RingBufferSink::write(std::string_view text)
+{
+    if (!in_run_)
+    {
+        begin_run();
+    }
+    const auto capacity{buffer_.size()};
+    if (text.size() >= capacity)
+    {
+        truncated_ = truncated_ || size_ + text.size() > capacity;
+        std::copy(text.end() - capacity, text.end(), buffer_.begin());
+        head_ = 0;
+        size_ = capacity;
+        return;
+    }
+    const auto tail{(head_ + size_) % capacity};
+    const auto first_part{std::min(text.size(), capacity - tail)};
+    std::copy(text.begin(), text.begin() + first_part, buffer_.begin() + tail);
+    std::copy(text.begin() + first_part, text.end(), buffer_.begin());
+    size_ += text.size();
+    if (size_ > capacity)
+    {
+        head_ = (head_ + size_ - capacity) % capacity;
+        size_ = capacity;
+        truncated_ = true;
+    }
+}
+
+void RingBufferSink::commit()
+{
+    if (!in_run_)
+    {
+        begin_run();
+    }
+    in_run_ = false;
+}
+
+void RingBufferSink::discard()
+{
+    begin_run();
+    discarded_ = true;
+    in_run_ = false;
+}
+
+std::string RingBufferSink::contents() const
+{
+    if (discarded_)
+    {
+        return "-1";
+    }
+    const auto first_part{std::min(size_, buffer_.size() - head_)};
+    std::string contents{buffer_, head_, first_part};
+    contents.append(buffer_, 0, size_ - first_part);
+    return contents;
+}
+
+bool RingBufferSink::truncated() const
+{
+    return truncated_;
+}
+
+void RingBufferSink::begin_run()
+{
+    head_ = 0;
+    size_ = 0;
+    truncated_ = false;
+    discarded_ = false;
+    in_run_ = true;
+}
@@ -0,0 +1,78 @@
+#ifndef OUTPUT_SINK_H
+#define OUTPUT_SINK_H
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <string_view>
+
+// Destination of the output of msg, written in chunks while the program runs. A run finishes with commit when
+// the program reached end and with discard otherwise, in which case its output stands for -1.
+class OutputSink
+{
+  public:
+    virtual ~OutputSink() = default;
+    virtual void write(std::string_view text) = 0;
+    virtual void commit() = 0;
+    virtual void discard() = 0;
+};
+
+// Hands every chunk to a callback, and whether the run ended to another one.
+class CallbackSink : public OutputSink
+{
+  public:
+    using Writer = std::function<void(std::string_view)>;
+    using Finisher = std::function<void(bool committed)>;
+
+    explicit CallbackSink(Writer writer, Finisher finisher = {});
+    void write(std::string_view text) override;
+    void commit() override;
+    void discard() override;
+
+  private:
+    Writer writer_{};
+    Finisher finisher_{};
+};
+
+// Writes to a file descriptor it does not own. Discarding truncates a seekable file back to where the run
+// started before writing -1, pipes and terminals keep what was already streamed, followed by -1.
+class FileDescriptorSink : public OutputSink
+{
+  public:
+    explicit FileDescriptorSink(int fd);
+    void write(std::string_view text) override;
+    void commit() override;
+    void discard() override;
+
+  private:
+    void write_all(std::string_view text);
+    void begin_run();
+
+    int fd_{-1};
+    long long run_start_{-1};
+    bool in_run_{false};
+};
+
+// Keeps the last `capacity` characters of the output of the latest run.
+class RingBufferSink : public OutputSink
+{
+  public:
+    explicit RingBufferSink(std::size_t capacity);
+    void write(std::string_view text) override;
+    void commit() override;
+    void discard() override;
+    std::string contents() const;
+    bool truncated() const;
+
+  private:
+    void begin_run();
+
+    std::string buffer_{};
+    std::size_t head_{0};
+    std::size_t size_{0};
+    bool truncated_{false};
+    bool discarded_{false};
+    bool in_run_{false};
+};
+
+#endif /* OUTPUT_SINK_H */
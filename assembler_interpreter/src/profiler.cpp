@@ -0,0 +1,188 @@
+#include "assembler_interpreter/src/profiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <sstream>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace
+{
+// Source instruction an op was compiled from, the last one starting at or before it.
+std::size_t source_index_of(Bytecode const& program, std::uint32_t op)
+{
+    auto const& source_to_code{program.source_to_code};
+    const auto next{std::upper_bound(source_to_code.begin(), std::prev(source_to_code.end()), op)};
+    return static_cast<std::size_t>(std::distance(source_to_code.begin(), next)) - 1;
+}
+}  // namespace
+
+std::string Profile::report(std::size_t top) const
+{
+    const auto share{[this](std::uint64_t ticks) {
+        return total_ticks == 0 ? 0.0 : 100.0 * static_cast<double>(ticks) / static_cast<double>(total_ticks);
+    }};
+    std::ostringstream report{};
+    report << std::fixed << std::setprecision(1);
+    report << "total ticks: " << total_ticks << "\n\nhot instructions\n";
+    report << std::setw(8) << "op" << std::setw(8) << "source" << "  " << std::left << std::setw(9) << "opcode"
+           << std::setw(16) << "label" << std::right << std::setw(14) << "count" << std::setw(16) << "ticks"
+           << std::setw(8) << "%" << '\n';
+    for (std::size_t index{0}; index < std::min(top, ops.size()); ++index)
+    {
+        auto const& op{ops[index]};
+        report << std::setw(8) << op.op << std::setw(8) << op.source_index << "  " << std::left << std::setw(9)
+               << opcode_name(op.code) << std::setw(16) << op.label << std::right << std::setw(14) << op.count
+               << std::setw(16) << op.ticks << std::setw(8) << share(op.ticks) << '\n';
+    }
+    report << "\nsubroutines\n";
+    report << std::left << std::setw(24) << "name" << std::right << std::setw(14) << "calls" << std::setw(16)
+           << "inclusive" << std::setw(8) << "%" << std::setw(16) << "exclusive" << std::setw(8) << "%" << '\n';
+    for (auto const& subroutine : subroutines)
+    {
+        report << std::left << std::setw(24) << subroutine.name << std::right << std::setw(14) << subroutine.calls
+               << std::setw(16) << subroutine.inclusive_ticks << std::setw(8) << share(subroutine.inclusive_ticks)
+               << std::setw(16) << subroutine.exclusive_ticks << std::setw(8) << share(subroutine.exclusive_ticks)
+               << '\n';
+    }
+    return report.str();
+}
+
+Profiler::Profiler(Bytecode const& program, Labels labels)
+    : program_{program},
+      labels_{std::move(labels)},
+      counts_(program.code.size(), 0),
+      ticks_(program.code.size(), 0),
+      subroutines_{{"<main>"}},
+      frames_{{0}}
+{
+    std::stable_sort(labels_.begin(), labels_.end(), [](auto const& lhs, auto const& rhs) {
+        return lhs.second < rhs.second;
+    });
+    start_ = now();
+    last_read_ = start_;
+}
+
+void Profiler::call(std::uint32_t target)
+{
+    enter(target, false);
+}
+
+void Profiler::ret()
+{
+    while (frames_.size() > 1 && frames_.back().tail_call)
+    {
+        frames_.pop_back();
+    }
+    if (frames_.size() > 1)
+    {
+        frames_.pop_back();
+    }
+}
+
+void Profiler::tail_call(std::uint32_t target)
+{
+    enter(target, true);
+}
+
+void Profiler::enter(std::uint32_t target, bool tail_call)
+{
+    auto subroutine{subroutine_of_target_.find(target)};
+    if (subroutine == subroutine_of_target_.end())
+    {
+        const auto label{std::find_if(labels_.begin(), labels_.end(), [target](auto const& label) {
+            return label.second == target;
+        })};
+        auto name{label != labels_.end() ? label->first : "@" + std::to_string(target)};
+        subroutines_.push_back({std::move(name)});
+        subroutine = subroutine_of_target_.emplace(target, subroutines_.size() - 1).first;
+    }
+    ++subroutines_[subroutine->second].calls;
+    if (tail_call && frames_.back().tail_call)
+    {
+        frames_.back().subroutine = subroutine->second;
+        return;
+    }
+    frames_.push_back({subroutine->second, tail_call});
+}
+
+Profile Profiler::finish()
+{
+    sample();
+
+    Profile profile{};
+    profile.total_ticks = last_read_ - start_;
+    for (std::uint32_t op{0}; op < counts_.size(); ++op)
+    {
+        if (counts_[op] != 0)
+        {
+            profile.ops.push_back({op,
+                                   source_index_of(program_, op),
+                                   program_.code[op].code,
+                                   std::string{label_at(op)},
+                                   counts_[op],
+                                   ticks_[op]});
+        }
+    }
+    std::stable_sort(profile.ops.begin(), profile.ops.end(), [](auto const& lhs, auto const& rhs) {
+        return std::make_pair(lhs.ticks, lhs.count) > std::make_pair(rhs.ticks, rhs.count);
+    });
+    for (auto const& subroutine : subroutines_)
+    {
+        profile.subroutines.push_back(
+            {subroutine.name, subroutine.calls, subroutine.inclusive_ticks, subroutine.exclusive_ticks});
+    }
+    std::stable_sort(profile.subroutines.begin(), profile.subroutines.end(), [](auto const& lhs, auto const& rhs) {
+        return lhs.inclusive_ticks > rhs.inclusive_ticks;
+    });
+    return profile;
+}
+
+std::uint64_t Profiler::now()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                          std::chrono::steady_clock::now().time_since_epoch())
+                                          .count());
+#endif
+}
+
+void Profiler::sample()
+{
+    const auto read{now()};
+    const auto elapsed{read - last_read_};
+    last_read_ = read;
+    ++samples_;
+
+    if (current_op_ < ticks_.size())
+    {
+        ticks_[current_op_] += elapsed;
+    }
+    subroutines_[frames_.back().subroutine].exclusive_ticks += elapsed;
+    for (auto const frame : frames_)
+    {
+        auto& subroutine{subroutines_[frame.subroutine]};
+        if (subroutine.last_sample != samples_)
+        {
+            subroutine.last_sample = samples_;
+            subroutine.inclusive_ticks += elapsed;
+        }
+    }
+
+    random_state_ ^= random_state_ << 13;
+    random_state_ ^= random_state_ >> 17;
+    random_state_ ^= random_state_ << 5;
+    countdown_ = 32 + (random_state_ & 63);
+}
+
+std::string_view Profiler::label_at(std::uint32_t op) const
+{
+    const auto next{std::upper_bound(labels_.begin(), labels_.end(), op, [](std::uint32_t op, auto const& label) {
+        return op < label.second;
+    })};
+    return next == labels_.begin() ? std::string_view{} : std::string_view{std::prev(next)->first};
+}
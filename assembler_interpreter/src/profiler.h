@@ -0,0 +1,126 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "assembler_interpreter/src/bytecode.h"
+
+struct OpProfile
+{
+    std::uint32_t op{0};
+    std::size_t source_index{0};
+    OpCode code{OpCode::End};
+    std::string label{};
+    std::uint64_t count{0};
+    std::uint64_t ticks{0};
+};
+
+struct SubroutineProfile
+{
+    std::string name{};
+    std::uint64_t calls{0};
+    std::uint64_t inclusive_ticks{0};
+    std::uint64_t exclusive_ticks{0};
+};
+
+// Result of a profiled run. Ops are sorted by time, then by count, subroutines by inclusive time. Ticks are
+// time stamp counter cycles on x86 and steady clock nanoseconds elsewhere.
+struct Profile
+{
+    std::uint64_t total_ticks{0};
+    std::vector<OpProfile> ops{};
+    std::vector<SubroutineProfile> subroutines{};
+
+    std::string report(std::size_t top) const;
+};
+
+// Hooks of an unprofiled run, compiled away entirely.
+struct Unprofiled
+{
+    void execute(std::uint32_t) {}
+    void call(std::uint32_t) {}
+    void ret() {}
+    void tail_call(std::uint32_t) {}
+    void retire(std::uint32_t, Op const&, unsigned int) {}
+    bool preempt()
+    {
+        return false;
+    }
+};
+
+// Counts every op exactly and reads the clock only every few dozen ops, charging the time since the previous
+// read to the op and the subroutines active at the read. A subroutine entered by a tail call stays active until
+// the subroutine that made the call returns, or until it makes a tail call itself, which takes its frame. Tail
+// recursion so runs in a constant number of frames. The sampling interval is jittered, so loops whose length
+// divides it are not charged to one of their ops only.
+class Profiler
+{
+  public:
+    using Labels = std::vector<std::pair<std::string, std::uint32_t>>;
+
+    Profiler(Bytecode const& program, Labels labels);
+    void execute(std::uint32_t op)
+    {
+        ++counts_[op];
+        current_op_ = op;
+        if (--countdown_ == 0)
+        {
+            sample();
+        }
+    }
+    void call(std::uint32_t target);
+    void ret();
+    void tail_call(std::uint32_t target);
+    void retire(std::uint32_t, Op const&, unsigned int) {}
+    bool preempt()
+    {
+        return false;
+    }
+    // Frames of the subroutines active right now, the one of the main program included.
+    std::size_t depth() const
+    {
+        return frames_.size();
+    }
+    Profile finish();
+
+  private:
+    struct Subroutine
+    {
+        std::string name{};
+        std::uint64_t calls{0};
+        std::uint64_t inclusive_ticks{0};
+        std::uint64_t exclusive_ticks{0};
+        std::uint64_t last_sample{0};
+    };
+    struct Frame
+    {
+        std::size_t subroutine{0};
+        bool tail_call{false};
+    };
+
+    static std::uint64_t now();
+    void enter(std::uint32_t target, bool tail_call);
+    void sample();
+    std::string_view label_at(std::uint32_t op) const;
+
+    Bytecode const& program_;
+    Labels labels_{};
+    std::vector<std::uint64_t> counts_{};
+    std::vector<std::uint64_t> ticks_{};
+    std::vector<Subroutine> subroutines_{};
+    std::unordered_map<std::uint32_t, std::size_t> subroutine_of_target_{};
+    std::vector<Frame> frames_{};
+    std::uint32_t current_op_{0};
+    std::uint32_t countdown_{64};
+    std::uint32_t random_state_{0x9e3779b9};
+    std::uint64_t samples_{0};
+    std::uint64_t start_{0};
+    std::uint64_t last_read_{0};
+};
+
+#endif /* PROFILER_H */
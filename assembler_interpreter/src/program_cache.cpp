@@ -0,0 +1,67 @@
+#include "assembler_interpreter/src/program_cache.h"
+#include <functional>
+
+ProgramCache::ProgramCache(std::size_t capacity) : capacity_{capacity} {}
+
+// Compiles outside the lock, so a miss does not hold up lookups of other programs.
+CompiledProgram ProgramCache::get(std::string_view source)
+{
+    const auto hash{std::hash<std::string_view>{}(source)};
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+        const auto entry{index_.find(hash)};
+        if (entry != index_.end() && entry->second->source == source)
+        {
+            entries_.splice(entries_.begin(), entries_, entry->second);
+            ++hits_;
+            return entry->second->program;
+        }
+        ++misses_;
+    }
+
+    auto program{compile(source)};
+    std::lock_guard<std::mutex> lock{mutex_};
+    const auto entry{index_.find(hash)};
+    if (entry != index_.end())
+    {
+        entries_.erase(entry->second);
+        index_.erase(entry);
+    }
+    if (capacity_ == 0)
+    {
+        return program;
+    }
+    if (entries_.size() == capacity_)
+    {
+        index_.erase(entries_.back().hash);
+        entries_.pop_back();
+    }
+    entries_.push_front({hash, std::string{source}, program});
+    index_.emplace(hash, entries_.begin());
+    return program;
+}
+
+std::size_t ProgramCache::size() const
+{
+    std::lock_guard<std::mutex> lock{mutex_};
+    return entries_.size();
+}
+
+std::size_t ProgramCache::hits() const
+{
+    std::lock_guard<std::mutex> lock{mutex_};
+    return hits_;
+}
+
+std::size_t ProgramCache::misses() const
+{
+    std::lock_guard<std::mutex> lock{mutex_};
+    return misses_;
+}
+
+CompiledProgram ProgramCache::compile(std::string_view source)
+{
+    Machine machine{};
+    machine.load_program(source);
+    return machine.compiled_program();
+}
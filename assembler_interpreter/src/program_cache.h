@@ -0,0 +1,41 @@
+#ifndef PROGRAM_CACHE_H
+#define PROGRAM_CACHE_H
+
+#include <cstddef>
+#include <list>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include "assembler_interpreter/src/machine.h"
+
+// Thread safe least recently used cache of compiled programs, keyed by the hash of their source. Entries keep
+// their source, so a hash collision costs a compilation instead of returning the wrong program.
+class ProgramCache
+{
+  public:
+    explicit ProgramCache(std::size_t capacity);
+    CompiledProgram get(std::string_view source);
+    std::size_t size() const;
+    std::size_t hits() const;
+    std::size_t misses() const;
+
+  private:
+    struct Entry
+    {
+        std::size_t hash{0};
+        std::string source{};
+        CompiledProgram program{};
+    };
+
+    static CompiledProgram compile(std::string_view source);
+
+    mutable std::mutex mutex_{};
+    std::size_t capacity_{0};
+    std::list<Entry> entries_{};
+    std::unordered_map<std::size_t, std::list<Entry>::iterator> index_{};
+    std::size_t hits_{0};
+    std::size_t misses_{0};
+};
+
+#endif /* PROGRAM_CACHE_H */
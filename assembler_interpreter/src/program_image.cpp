@@ -0,0 +1,409 @@
+#include "assembler_interpreter/src/program_image.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace
+{
+constexpr char image_magic[4]{'A', 'S', 'M', 'I'};
+constexpr std::uint32_t image_version{2};
+constexpr std::uint32_t byte_order_mark{0x01020304};
+constexpr std::uint32_t opcode_count{static_cast<std::uint32_t>(OpCode::TailCall) + 1};
+
+class ImageWriter
+{
+  public:
+    void u32(std::uint32_t value)
+    {
+        bytes(&value, sizeof(value));
+    }
+    void u64(std::uint64_t value)
+    {
+        bytes(&value, sizeof(value));
+    }
+    void text(std::string_view value)
+    {
+        u32(static_cast<std::uint32_t>(value.size()));
+        bytes(value.data(), value.size());
+    }
+    void op(Op const& value)
+    {
+        u32(static_cast<std::uint32_t>(value.code));
+        u32(value.a);
+        u32(value.b);
+        u32(value.c);
+    }
+    void slots(std::vector<Slot> const& values)
+    {
+        u32(static_cast<std::uint32_t>(values.size()));
+        for (auto const value : values)
+        {
+            u32(value);
+        }
+    }
+    void bytes(void const* data, std::size_t size)
+    {
+        image_.append(static_cast<char const*>(data), size);
+    }
+    std::string& image()
+    {
+        return image_;
+    }
+
+  private:
+    std::string image_{};
+};
+
+// Every read is bounds checked, a count is only trusted once the bytes its elements need are there.
+class ImageReader
+{
+  public:
+    explicit ImageReader(std::string_view image) : rest_{image} {}
+    std::uint32_t u32()
+    {
+        std::uint32_t value{0};
+        std::memcpy(&value, take(sizeof(value)).data(), sizeof(value));
+        return value;
+    }
+    std::uint64_t u64()
+    {
+        std::uint64_t value{0};
+        std::memcpy(&value, take(sizeof(value)).data(), sizeof(value));
+        return value;
+    }
+    std::string_view text()
+    {
+        return take(u32());
+    }
+    std::size_t count(std::size_t element_size)
+    {
+        const std::size_t count{u32()};
+        if (count > rest_.size() / element_size)
+        {
+            throw std::runtime_error{"Corrupt program image"};
+        }
+        return count;
+    }
+    Op op()
+    {
+        const auto code{u32()};
+        if (code >= opcode_count)
+        {
+            throw std::runtime_error{"Corrupt program image"};
+        }
+        const auto a{u32()};
+        const auto b{u32()};
+        return {static_cast<OpCode>(code), a, b, u32()};
+    }
+    std::vector<Slot> slots()
+    {
+        std::vector<Slot> values(count(sizeof(Slot)));
+        for (auto& value : values)
+        {
+            value = u32();
+        }
+        return values;
+    }
+    std::string_view take(std::size_t size)
+    {
+        if (size > rest_.size())
+        {
+            throw std::runtime_error{"Corrupt program image"};
+        }
+        const auto taken{rest_.substr(0, size)};
+        rest_.remove_prefix(size);
+        return taken;
+    }
+    bool at_end() const
+    {
+        return rest_.empty();
+    }
+
+  private:
+    std::string_view rest_{};
+};
+
+// Unmaps an image once it is decoded.
+struct Mapping
+{
+    ~Mapping()
+    {
+        ::munmap(data, size);
+    }
+    void* data{nullptr};
+    std::size_t size{0};
+};
+
+bool is_fused(OpCode code)
+{
+    return (code >= OpCode::CmpJne && code <= OpCode::CmpJl) || code == OpCode::DecJnz;
+}
+
+// Engines trust the bytecode they run, so every operand is checked against what it indexes.
+bool is_valid(Bytecode const& program, Op const& op)
+{
+    const auto slots{program.slot_count()};
+    const auto end{program.code.size()};
+    switch (op.code)
+    {
+        case OpCode::Inc:
+        case OpCode::Dec:
+            return op.a < slots;
+        case OpCode::Mov:
+        case OpCode::Add:
+        case OpCode::Sub:
+        case OpCode::Mul:
+        case OpCode::Div:
+        case OpCode::Cmp:
+            return op.a < slots && op.b < slots;
+        case OpCode::Jmp:
+        case OpCode::Jne:
+        case OpCode::Je:
+        case OpCode::Jge:
+        case OpCode::Jg:
+        case OpCode::Jle:
+        case OpCode::Jl:
+        case OpCode::Call:
+        case OpCode::TailCall:
+            return op.a <= end;
+        case OpCode::Jnz:
+            return op.a <= end && op.b < slots;
+        case OpCode::JnzDynamic:
+            return op.a < program.source_to_code.size() && op.b < slots && op.c < slots;
+        case OpCode::Ret:
+        case OpCode::End:
+            return true;
+        case OpCode::Msg:
+            return op.a < program.messages.size();
+        case OpCode::CmpJne:
+        case OpCode::CmpJe:
+        case OpCode::CmpJge:
+        case OpCode::CmpJg:
+        case OpCode::CmpJle:
+        case OpCode::CmpJl:
+            return op.a < slots && op.b < slots && op.c <= end;
+        case OpCode::DecJnz:
+            return op.a < slots && op.c <= end;
+        case OpCode::CountedLoop:
+            return op.a < program.loops.size();
+    }
+    return false;
+}
+
+bool is_valid(Bytecode const& program, CountedLoop const& loop)
+{
+    const auto slots{program.slot_count()};
+    const auto valid_slots{[slots](std::vector<Slot> const& values) {
+        return std::all_of(values.begin(), values.end(), [slots](auto const slot) { return slot < slots; });
+    }};
+    const auto valid_step{[&](LoopStep const& step) {
+        return step.slot < slots && valid_slots(step.added) && valid_slots(step.subtracted);
+    }};
+    return loop.backedge.code != OpCode::CountedLoop && is_valid(program, loop.backedge) && loop.counter < slots &&
+           loop.bound < slots && loop.head <= program.code.size() && loop.exit <= program.code.size() &&
+           loop.counter_step < loop.steps.size() && std::all_of(loop.steps.begin(), loop.steps.end(), valid_step);
+}
+
+void validate(Bytecode const& program)
+{
+    const auto end{program.code.size()};
+    bool valid{!program.source_to_code.empty()};
+    for (std::size_t index{0}; valid && index < end; ++index)
+    {
+        auto const& op{program.code[index]};
+        valid = is_valid(program, op) && (!is_fused(op.code) || index + 1 < end);
+    }
+    for (auto const target : program.source_to_code)
+    {
+        valid = valid && target <= end;
+    }
+    for (auto const& message : program.messages)
+    {
+        for (auto const& segment : message.segments())
+        {
+            valid = valid && (!segment.has_value || segment.slot < program.slot_count());
+        }
+    }
+    for (auto const& loop : program.loops)
+    {
+        valid = valid && is_valid(program, loop);
+    }
+    if (!valid)
+    {
+        throw std::runtime_error{"Corrupt program image"};
+    }
+}
+}  // namespace
+
+std::string encode_program_image(Bytecode const& program)
+{
+    ImageWriter writer{};
+    writer.bytes(image_magic, sizeof(image_magic));
+    writer.u32(image_version);
+    writer.u32(byte_order_mark);
+    writer.u32(sizeof(SlotValue));
+    writer.u32(opcode_count);
+
+    writer.u32(static_cast<std::uint32_t>(program.slot_count()));
+    for (std::size_t slot{0}; slot < program.slot_count(); ++slot)
+    {
+        writer.text(program.slot_names[slot]);
+        writer.u64(static_cast<std::uint64_t>(program.initial_slot_values[slot]));
+    }
+    writer.u32(static_cast<std::uint32_t>(program.code.size()));
+    for (auto const& op : program.code)
+    {
+        writer.op(op);
+    }
+    writer.slots(program.source_to_code);
+    writer.u32(static_cast<std::uint32_t>(program.messages.size()));
+    for (auto const& message : program.messages)
+    {
+        writer.u32(static_cast<std::uint32_t>(message.segments().size()));
+        for (auto const& segment : message.segments())
+        {
+            writer.text(segment.text);
+            writer.u32(segment.has_value);
+            writer.u32(segment.slot);
+        }
+    }
+    writer.u32(static_cast<std::uint32_t>(program.loops.size()));
+    for (auto const& loop : program.loops)
+    {
+        writer.op(loop.backedge);
+        writer.u32(static_cast<std::uint32_t>(loop.relation));
+        writer.u32(loop.counter);
+        writer.u32(loop.bound);
+        writer.u32(loop.head);
+        writer.u32(loop.exit);
+        writer.u32(static_cast<std::uint32_t>(loop.counter_step));
+        writer.u32(static_cast<std::uint32_t>(loop.steps.size()));
+        for (auto const& step : loop.steps)
+        {
+            writer.u32(step.slot);
+            writer.u64(static_cast<std::uint64_t>(step.constant));
+            writer.slots(step.added);
+            writer.slots(step.subtracted);
+        }
+    }
+    return std::move(writer.image());
+}
+
+CompiledProgram decode_program_image(std::string_view image)
+{
+    ImageReader reader{image};
+    if (reader.take(sizeof(image_magic)) != std::string_view{image_magic, sizeof(image_magic)})
+    {
+        throw std::runtime_error{"Not a program image"};
+    }
+    if (reader.u32() != image_version || reader.u32() != byte_order_mark || reader.u32() != sizeof(SlotValue) ||
+        reader.u32() != opcode_count)
+    {
+        throw std::runtime_error{"Unsupported program image version"};
+    }
+
+    Bytecode program{};
+    const auto slot_count{reader.count(sizeof(std::uint32_t) + sizeof(std::uint64_t))};
+    program.slot_names.reserve(slot_count);
+    program.initial_slot_values.reserve(slot_count);
+    for (std::size_t slot{0}; slot < slot_count; ++slot)
+    {
+        program.slot_names.emplace_back(reader.text());
+        program.initial_slot_values.push_back(static_cast<SlotValue>(reader.u64()));
+    }
+    program.code.resize(reader.count(4 * sizeof(std::uint32_t)));
+    for (auto& op : program.code)
+    {
+        op = reader.op();
+    }
+    program.source_to_code = reader.slots();
+    program.messages.resize(reader.count(sizeof(std::uint32_t)));
+    for (auto& message : program.messages)
+    {
+        const auto segment_count{reader.count(3 * sizeof(std::uint32_t))};
+        for (std::size_t segment{0}; segment < segment_count; ++segment)
+        {
+            message.add_text(reader.text());
+            const auto has_value{reader.u32() != 0};
+            const auto slot{reader.u32()};
+            if (has_value)
+            {
+                message.add_value(slot);
+            }
+        }
+    }
+    program.loops.resize(reader.count(11 * sizeof(std::uint32_t)));
+    for (auto& loop : program.loops)
+    {
+        loop.backedge = reader.op();
+        const auto relation{reader.u32()};
+        if (relation >= opcode_count)
+        {
+            throw std::runtime_error{"Corrupt program image"};
+        }
+        loop.relation = static_cast<OpCode>(relation);
+        loop.counter = reader.u32();
+        loop.bound = reader.u32();
+        loop.head = reader.u32();
+        loop.exit = reader.u32();
+        loop.counter_step = reader.u32();
+        loop.steps.resize(reader.count(5 * sizeof(std::uint32_t)));
+        for (auto& step : loop.steps)
+        {
+            step.slot = reader.u32();
+            step.constant = static_cast<std::int64_t>(reader.u64());
+            step.added = reader.slots();
+            step.subtracted = reader.slots();
+        }
+    }
+    if (!reader.at_end())
+    {
+        throw std::runtime_error{"Corrupt program image"};
+    }
+    validate(program);
+    return std::make_shared<Bytecode const>(std::move(program));
+}
+
+void write_program_image(Bytecode const& program, std::string const& path)
+{
+    const auto image{encode_program_image(program)};
+    std::ofstream file{path, std::ios::binary | std::ios::trunc};
+    file.write(image.data(), static_cast<std::streamsize>(image.size()));
+    if (!file)
+    {
+        throw std::runtime_error{"Cannot write program image " + path};
+    }
+}
+
+CompiledProgram load_program_image(std::string const& path)
+{
+    const auto fd{::open(path.c_str(), O_RDONLY)};
+    if (fd < 0)
+    {
+        throw std::runtime_error{"Cannot open program image " + path};
+    }
+    struct stat status{};
+    if (::fstat(fd, &status) != 0 || status.st_size == 0)
+    {
+        ::close(fd);
+        throw std::runtime_error{"Cannot read program image " + path};
+    }
+    const auto size{static_cast<std::size_t>(status.st_size)};
+    void* const mapped{::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0)};
+    ::close(fd);
+    if (mapped == MAP_FAILED)
+    {
+        throw std::runtime_error{"Cannot map program image " + path};
+    }
+    const Mapping mapping{mapped, size};
+    return decode_program_image({static_cast<char const*>(mapped), size});
+}
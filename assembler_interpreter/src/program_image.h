@@ -0,0 +1,19 @@
+#ifndef PROGRAM_IMAGE_H
+#define PROGRAM_IMAGE_H
+
+#include <string>
+#include <string_view>
+#include "assembler_interpreter/src/machine.h"
+
+// Binary form of a compiled program: its ops with resolved operands and jump targets, slots, msg templates and
+// counted loops, after a versioned header. The image holds offsets and counts only, no addresses, and is
+// written in host byte order; images from another version, byte order or word size are rejected.
+std::string encode_program_image(Bytecode const& program);
+CompiledProgram decode_program_image(std::string_view image);
+
+void write_program_image(Bytecode const& program, std::string const& path);
+// Maps the file read only, decodes it into a new Bytecode and unmaps it again, nothing refers to the mapping
+// afterwards. No source is parsed.
+CompiledProgram load_program_image(std::string const& path);
+
+#endif /* PROGRAM_IMAGE_H */
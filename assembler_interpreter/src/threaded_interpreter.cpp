@@ -0,0 +1,201 @@
+#include "assembler_interpreter/src/machine.h"
+
+#if defined(__GNUC__)
+
+// Direct threaded dispatch through GCC's labels as values. Every decoded op carries the address of its
+// handler, so each handler ends in its own indirect jump instead of sharing the one of a switch.
+template <typename Word>
+void BasicMachine<Word>::run_threaded()
+{
+    static void* const handlers[]{&&do_mov, &&do_inc, &&do_dec,  &&do_add, &&do_sub,  &&do_mul, &&do_div,
+                                  &&do_jmp, &&do_jnz, &&do_jnzd, &&do_cmp, &&do_jne,  &&do_je,  &&do_jge,
+                                  &&do_jg,  &&do_jle, &&do_jl,   &&do_call, &&do_ret, &&do_msg, &&do_end,
+                                  &&do_cmp_jne, &&do_cmp_je, &&do_cmp_jge, &&do_cmp_jg, &&do_cmp_jle, &&do_cmp_jl,
+                                  &&do_dec_jnz, &&do_counted_loop, &&do_tail_call};
+    static_assert(sizeof(handlers) / sizeof(handlers[0]) == static_cast<std::size_t>(OpCode::TailCall) + 1,
+                  "Every opcode needs a handler");
+
+    if (threaded_code_.empty())
+    {
+        for (auto const& op : bytecode_->code)
+        {
+            threaded_code_.push_back({handlers[static_cast<std::size_t>(op.code)], op.a, op.b, op.c});
+        }
+        threaded_code_.push_back({&&halt});
+    }
+    return_stack_.clear();
+
+    Word* const slots{slots_.data()};
+    std::uint8_t* const touched{touched_slots_.data()};
+    ThreadedOp const* const code{threaded_code_.data()};
+    ThreadedOp const* op{code};
+    Comparison<Word> comparison{comparison_};
+
+#define DISPATCH_NEXT() goto*(++op)->handler
+#define DISPATCH_TO(target)   \
+    op = code + (target);     \
+    goto* op->handler
+#define DISPATCH_SKIP()   \
+    op += 2;              \
+    goto* op->handler
+#define COMPARE_AND_JUMP(condition)                    \
+    comparison.set(slots[op->a], slots[op->b]);        \
+    if (slots[op->a] condition slots[op->b])           \
+    {                                                  \
+        DISPATCH_TO(op->c);                            \
+    }                                                  \
+    DISPATCH_SKIP()
+
+    goto* op->handler;
+
+do_mov:
+    slots[op->a] = slots[op->b];
+    touched[op->a] = 1;
+    DISPATCH_NEXT();
+do_inc:
+    slots[op->a] = wrapping_add(slots[op->a], Word{1});
+    touched[op->a] = 1;
+    DISPATCH_NEXT();
+do_dec:
+    slots[op->a] = wrapping_subtract(slots[op->a], Word{1});
+    touched[op->a] = 1;
+    DISPATCH_NEXT();
+do_add:
+    slots[op->a] = wrapping_add(slots[op->a], slots[op->b]);
+    touched[op->a] = 1;
+    DISPATCH_NEXT();
+do_sub:
+    slots[op->a] = wrapping_subtract(slots[op->a], slots[op->b]);
+    touched[op->a] = 1;
+    DISPATCH_NEXT();
+do_mul:
+    slots[op->a] = wrapping_multiply(slots[op->a], slots[op->b]);
+    touched[op->a] = 1;
+    DISPATCH_NEXT();
+do_div:
+    slots[op->a] = wrapping_divide(slots[op->a], slots[op->b]);
+    touched[op->a] = 1;
+    DISPATCH_NEXT();
+do_jmp:
+    DISPATCH_TO(op->a);
+do_jnz:
+    if (slots[op->b] != 0)
+    {
+        DISPATCH_TO(op->a);
+    }
+    DISPATCH_NEXT();
+do_jnzd:
+    if (slots[op->b] != 0)
+    {
+        DISPATCH_TO(bytecode_->relative_jump_target(op->a, slots[op->c]));
+    }
+    DISPATCH_NEXT();
+do_cmp:
+    comparison.set(slots[op->a], slots[op->b]);
+    DISPATCH_NEXT();
+do_jne:
+    if (comparison.holds(NotEqual))
+    {
+        DISPATCH_TO(op->a);
+    }
+    DISPATCH_NEXT();
+do_je:
+    if (comparison.holds(Equal))
+    {
+        DISPATCH_TO(op->a);
+    }
+    DISPATCH_NEXT();
+do_jge:
+    if (comparison.holds(GreaterOrEqual))
+    {
+        DISPATCH_TO(op->a);
+    }
+    DISPATCH_NEXT();
+do_jg:
+    if (comparison.holds(Greater))
+    {
+        DISPATCH_TO(op->a);
+    }
+    DISPATCH_NEXT();
+do_jle:
+    if (comparison.holds(LessOrEqual))
+    {
+        DISPATCH_TO(op->a);
+    }
+    DISPATCH_NEXT();
+do_jl:
+    if (comparison.holds(Less))
+    {
+        DISPATCH_TO(op->a);
+    }
+    DISPATCH_NEXT();
+do_call:
+    if (!return_stack_.push(static_cast<std::uint32_t>(op - code + 1)))
+    {
+        preempted_by_ = RunStatus::CallDepthLimit;
+        goto halt;
+    }
+    DISPATCH_TO(op->a);
+do_ret:
+    if (return_stack_.empty())
+    {
+        goto halt;
+    }
+    else
+    {
+        const auto return_address{return_stack_.pop()};
+        DISPATCH_TO(return_address);
+    }
+do_tail_call:
+    DISPATCH_TO(op->a);
+do_msg:
+    write_message(op->a);
+    DISPATCH_NEXT();
+do_cmp_jne:
+    COMPARE_AND_JUMP(!=);
+do_cmp_je:
+    COMPARE_AND_JUMP(==);
+do_cmp_jge:
+    COMPARE_AND_JUMP(>=);
+do_cmp_jg:
+    COMPARE_AND_JUMP(>);
+do_cmp_jle:
+    COMPARE_AND_JUMP(<=);
+do_cmp_jl:
+    COMPARE_AND_JUMP(<);
+do_dec_jnz:
+    touched[op->a] = 1;
+    slots[op->a] = wrapping_subtract(slots[op->a], Word{1});
+    if (slots[op->a] != 0)
+    {
+        DISPATCH_TO(op->c);
+    }
+    DISPATCH_SKIP();
+do_counted_loop:
+    comparison_ = comparison;
+    op = code + run_counted_loop(op->a);
+    comparison = comparison_;
+    goto* op->handler;
+do_end:
+    ended_ = true;
+halt:
+    comparison_ = comparison;
+
+#undef COMPARE_AND_JUMP
+#undef DISPATCH_SKIP
+#undef DISPATCH_TO
+#undef DISPATCH_NEXT
+}
+
+#else
+
+template <typename Word>
+void BasicMachine<Word>::run_threaded()
+{
+    run_bytecode();
+}
+
+#endif
+
+template void BasicMachine<std::int32_t>::run_threaded();
+template void BasicMachine<std::int64_t>::run_threaded();
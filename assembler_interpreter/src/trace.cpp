@@ -0,0 +1,63 @@
+#include "assembler_interpreter/src/trace.h"
+
+#include <algorithm>
+#include <sstream>
+#include "assembler_interpreter/src/machine.h"
+
+TraceBuffer::TraceBuffer(std::size_t capacity)
+{
+    std::uint64_t rounded{1};
+    while (rounded < capacity)
+    {
+        rounded <<= 1;
+    }
+    records_ = std::make_unique<TraceRecord[]>(rounded);
+    mask_ = rounded - 1;
+}
+
+std::vector<TraceRecord> TraceBuffer::snapshot() const
+{
+    const auto end{published_.load(std::memory_order_acquire)};
+    const auto begin{end - std::min(end, capacity())};
+    std::vector<TraceRecord> records(records_.get() + (begin & mask_), records_.get() + capacity());
+    records.insert(records.end(), records_.get(), records_.get() + (begin & mask_));
+    records.resize(end - begin);
+
+    // The writer is free to go on meanwhile, records it overwrote are dropped.
+    const auto end_after_copy{published_.load(std::memory_order_acquire)};
+    const auto first_intact{end_after_copy - std::min(end_after_copy, capacity())};
+    const auto overwritten{std::min<std::uint64_t>(records.size(), first_intact - std::min(first_intact, begin))};
+    records.erase(records.begin(), records.begin() + overwritten);
+    return records;
+}
+
+std::uint64_t TraceBuffer::recorded() const
+{
+    return published_.load(std::memory_order_acquire);
+}
+
+std::size_t TraceBuffer::capacity() const
+{
+    return mask_ + 1;
+}
+
+std::string format_trace(std::vector<TraceRecord> const& records, Bytecode const& program)
+{
+    std::ostringstream listing{};
+    for (auto const& record : records)
+    {
+        const auto code{static_cast<OpCode>(record.code)};
+        listing << record.ip << ' ' << opcode_name(code);
+        if (record.slot != TraceRecord::no_slot)
+        {
+            listing << ' ' << program.slot_names[record.slot] << '=' << record.value;
+        }
+        const bool compares{code == OpCode::Cmp || (code >= OpCode::CmpJne && code <= OpCode::CmpJl)};
+        if (compares)
+        {
+            listing << ((record.flags & Equal) ? " [==]" : (record.flags & Less) ? " [<]" : " [>]");
+        }
+        listing << '\n';
+    }
+    return listing.str();
+}
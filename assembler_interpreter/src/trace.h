@@ -0,0 +1,107 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "assembler_interpreter/src/bytecode.h"
+
+// One executed op: where it ran, the slot it wrote and the value it left there, and the comparison flags
+// after it. Ops writing no slot record no_slot.
+struct TraceRecord
+{
+    static constexpr std::uint32_t no_slot{0xffffffff};
+
+    std::uint32_t ip{0};
+    std::uint8_t code{0};
+    std::uint8_t flags{0};
+    std::uint16_t reserved{0};
+    std::uint32_t slot{no_slot};
+    SlotValue value{0};
+};
+
+// Preallocated ring keeping the latest records of one writer, the machine running with it. Records are
+// published with a release store of their count, so snapshot can be taken from another thread while the
+// program runs. Records overwritten meanwhile are dropped from it, only its oldest one may be torn.
+class TraceBuffer
+{
+  public:
+    explicit TraceBuffer(std::size_t capacity);
+    void record(TraceRecord const& record)
+    {
+        records_[next_ & mask_] = record;
+        published_.store(++next_, std::memory_order_release);
+    }
+    std::vector<TraceRecord> snapshot() const;
+    std::uint64_t recorded() const;
+    std::size_t capacity() const;
+
+  private:
+    std::unique_ptr<TraceRecord[]> records_{};
+    std::uint64_t mask_{0};
+    std::uint64_t next_{0};
+    std::atomic<std::uint64_t> published_{0};
+};
+
+// Hooks of a traced run, filling a record per executed op.
+template <typename Word>
+class Tracer
+{
+  public:
+    Tracer(TraceBuffer& buffer, Bytecode const& program, Word const* slots)
+        : buffer_{buffer}, program_{program}, slots_{slots}
+    {
+    }
+    void execute(std::uint32_t) {}
+    void call(std::uint32_t) {}
+    void ret() {}
+    void tail_call(std::uint32_t) {}
+    void retire(std::uint32_t ip, Op const& op, unsigned int flags)
+    {
+        const auto slot{written_slot(op)};
+        buffer_.record({ip,
+                        static_cast<std::uint8_t>(op.code),
+                        static_cast<std::uint8_t>(flags),
+                        0,
+                        slot,
+                        slot == TraceRecord::no_slot ? 0 : slots_[slot]});
+    }
+    bool preempt()
+    {
+        return false;
+    }
+
+  private:
+    std::uint32_t written_slot(Op const& op) const
+    {
+        switch (op.code)
+        {
+            case OpCode::Mov:
+            case OpCode::Inc:
+            case OpCode::Dec:
+            case OpCode::Add:
+            case OpCode::Sub:
+            case OpCode::Mul:
+            case OpCode::Div:
+            case OpCode::DecJnz:
+                return op.a;
+            case OpCode::CountedLoop:
+                return program_.loops[op.a].counter;
+            default:
+                return TraceRecord::no_slot;
+        }
+    }
+
+    TraceBuffer& buffer_;
+    Bytecode const& program_;
+    Word const* slots_{nullptr};
+};
+
+// Readable listing of trace records, one line per record, naming the slots after the registers of program.
+// The flags are listed for comparing ops only.
+std::string format_trace(std::vector<TraceRecord> const& records, Bytecode const& program);
+
+#endif /* TRACE_H */
@@ -44,6 +44,16 @@ end
     EXPECT_EQ(assembler_interpreter(program), "Reg: 5");
 }
 
+TEST(AssemblerInterpreter, MsgInstructionQuotedDelimiters)
+{
+    std::string program{R"(
+mov  a, 5
+msg 'a; b, c ', a ; comment
+end
+)"};
+    EXPECT_EQ(assembler_interpreter(program), "a; b, c 5");
+}
+
 TEST(AssemblerInterpreter, MsgOnlyWrittenIfEndIsExecuted)
 {
     std::string program{R"( ; My first program
@@ -0,0 +1,66 @@
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include "assembler_interpreter/src/assembler_main.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace
+{
+std::vector<std::string> counting_programs(int count)
+{
+    std::vector<std::string> programs{};
+    for (int program{0}; program < count; ++program)
+    {
+        programs.push_back("mov a, " + std::to_string(program) + "\nmul a, a\nmsg 'a = ', a\nend\n");
+    }
+    return programs;
+}
+}  // namespace
+
+TEST(BatchTest, OutputsFollowProgramOrder)
+{
+    const auto programs{counting_programs(200)};
+    std::vector<std::string> expected{};
+    for (auto const& program : programs)
+    {
+        expected.push_back(assembler_interpreter(program));
+    }
+    EXPECT_THAT(assembler_interpreter_batch(programs, 8), ::testing::ContainerEq(expected));
+}
+
+TEST(BatchTest, MoreWorkersThanPrograms)
+{
+    EXPECT_THAT(assembler_interpreter_batch(counting_programs(2), 16), ::testing::ElementsAre("a = 0", "a = 1"));
+    EXPECT_TRUE(assembler_interpreter_batch({}, 4).empty());
+}
+
+TEST(BatchTest, FailingProgramIsRethrown)
+{
+    auto programs{counting_programs(20)};
+    programs[7] = "jmp nowhere\nend\n";
+    EXPECT_THROW(assembler_interpreter_batch(programs, 4), std::out_of_range);
+}
+
+TEST(BatchTest, ConcurrentBatchesShareTheWorkers)
+{
+    const auto programs{counting_programs(100)};
+    const auto expected{assembler_interpreter_batch(programs, 1)};
+    std::vector<std::vector<std::string>> outputs(4);
+    std::vector<std::thread> threads{};
+    for (auto& output : outputs)
+    {
+        threads.emplace_back([&programs, &output]() {
+            for (int batch{0}; batch < 10; ++batch)
+            {
+                output = assembler_interpreter_batch(programs, 4);
+            }
+        });
+    }
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+    EXPECT_THAT(outputs, ::testing::Each(::testing::ContainerEq(expected)));
+}
@@ -0,0 +1,187 @@
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "assembler_interpreter/src/assembler_main.h"
+#include "assembler_interpreter/src/machine.h"
+#include "gtest/gtest.h"
+
+namespace
+{
+std::string run_propagated(Machine& machine, ExecutionEngine engine, std::string_view program)
+{
+    machine.set_engine(engine);
+    machine.set_constant_propagation(true);
+    machine.load_program(program);
+    machine.run_program();
+    return machine.flush();
+}
+}  // namespace
+
+// The reference engine runs the instruction objects, which propagation leaves alone.
+class ConstantPropagationTest : public ::testing::TestWithParam<ExecutionEngine>
+{
+  protected:
+    std::string run(std::string_view program)
+    {
+        return run_propagated(machine_, GetParam(), program);
+    }
+
+    Machine machine_{};
+};
+
+TEST_P(ConstantPropagationTest, FoldsKnownValuesAndDecidedBranches)
+{
+    EXPECT_EQ(run(R"(
+mov a, 5
+add a, 3
+mul a, 2
+cmp a, 16
+jne wrong
+msg 'a = ', a
+end
+wrong:
+    msg 'wrong'
+    end
+)"),
+              "a = 16");
+    EXPECT_EQ(machine_.eliminated_instructions(), 4u);
+
+    const auto program{machine_.compiled_program()};
+    ASSERT_EQ(program->code.size(), 5u);
+    EXPECT_EQ(program->code[2].code, OpCode::Mov);
+    EXPECT_EQ(program->initial_slot_values[program->code[2].b], 16);
+    EXPECT_EQ(program->code[3].code, OpCode::Msg);
+    auto const& segments{program->messages[program->code[3].a].segments()};
+    ASSERT_EQ(segments.size(), 1u);
+    EXPECT_EQ(segments.front().text, "a = 16");
+    EXPECT_FALSE(segments.front().has_value);
+}
+
+TEST_P(ConstantPropagationTest, SeededRegistersStayUnknown)
+{
+    machine_.set_engine(GetParam());
+    machine_.set_constant_propagation(true);
+    machine_.load_program(std::string_view{R"(
+    mov b, a
+    mul b, a
+    cmp b, 10
+    jl small
+    msg a, ' squared is ', b
+    end
+small:
+    msg 'too small'
+    end
+)"});
+    EXPECT_EQ(machine_.eliminated_instructions(), 0u);
+    machine_.set_register("a", 4);
+    machine_.run_program();
+    EXPECT_EQ(machine_.flush(), "4 squared is 16");
+    machine_.set_register("a", 3);
+    machine_.run_program();
+    EXPECT_EQ(machine_.flush(), "too small");
+}
+
+TEST_P(ConstantPropagationTest, CallsLeaveTheRegistersTheyWriteUnknown)
+{
+    EXPECT_EQ(run(R"(
+mov a, 1
+mov b, 10
+call bump
+cmp a, 1
+je unchanged
+msg 'a = ', a, ', b = ', b
+end
+unchanged:
+    msg 'unchanged'
+    end
+bump:
+    inc a
+    ret
+)"),
+              "a = 2, b = 10");
+    EXPECT_EQ(machine_.get_registers().at("a"), 2);
+}
+
+TEST_P(ConstantPropagationTest, ProgramsKeepTheirOutput)
+{
+    const std::vector<std::pair<std::string, std::string>> programs{
+        {R"(
+jne no_compare_yet
+je no_compare_yet
+mov a, 4
+cmp a, 7
+mov a, 9
+call change_operands
+jge wrong
+jle less_or_equal
+wrong:
+    msg 'wrong'
+    end
+less_or_equal:
+    jl less
+    msg 'not less'
+    end
+less:
+    msg 'less, a = ', a
+    end
+change_operands:
+    mul a, 2
+    ret
+no_compare_yet:
+    msg 'jumped without a comparison'
+    end
+)",
+         "less, a = 18"},
+        {R"(
+mov a, 0
+mov b, 0
+cmp a, 1
+jmp second
+again:
+    cmp a, 0
+second:
+    jl less
+    inc b
+    jmp finish
+less:
+    inc a
+    inc b
+    jmp again
+finish:
+    msg 'a = ', a, ', b = ', b
+    end
+)",
+         "a = 1, b = 2"},
+        {R"(
+mov a, 3
+cmp a, 2
+jl never
+jg greater
+msg 'not greater'
+end
+greater:
+    msg 'greater'
+    end
+never:
+    msg 'less'
+    end
+)",
+         "greater"},
+        {"mov a, 0\nmov c, 0\nloop:\n    add c, 3\n    inc a\n    cmp a, 10\n    jl loop\nmsg 'c = ', c\nend\n",
+         "c = 30"},
+        // 2 * 2147483647 wraps around to -2, the folder has to leave it to the engines.
+        {"mov a, -7\nmov b, 2\ndiv a, b\nmul b, 2147483647\nmsg 'a = ', a, ', b = ', b\nend\n", "a = -3, b = -2"},
+        {"mov a, -2147483648\nmov b, 2147483647\nmsg a, b, '', ' and ', 'then ', 0\nend\n",
+         "-21474836482147483647 and then 0"},
+        {"mov a, 5\njnz a, 2\nmov a, 6\nmsg 'a = ', a\n", "-1"}};
+    for (auto const& program : programs)
+    {
+        Machine machine{};
+        EXPECT_EQ(run_propagated(machine, GetParam(), program.first), program.second) << program.first;
+    }
+}
+
+INSTANTIATE_TEST_CASE_P(Engines,
+                        ConstantPropagationTest,
+                        ::testing::Values(ExecutionEngine::Bytecode, ExecutionEngine::Threaded, ExecutionEngine::Jit));
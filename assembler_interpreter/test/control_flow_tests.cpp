@@ -0,0 +1,74 @@
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "assembler_interpreter/src/control_flow.h"
+#include "assembler_interpreter/src/machine.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace
+{
+CompiledProgram compile(std::string_view source)
+{
+    Machine machine{};
+    machine.set_loop_collapsing(false);
+    machine.load_program(source);
+    return machine.compiled_program();
+}
+}  // namespace
+
+using ::testing::ElementsAre;
+using ::testing::UnorderedElementsAre;
+
+TEST(ControlFlowGraphTest, BlocksEndAtBranchesAndStartAtTargets)
+{
+    const auto program{compile(R"(
+mov a, 0
+loop:
+    inc a
+    cmp a, 5
+    jl loop
+call print
+end
+print:
+    msg 'a = ', a
+    ret
+)")};
+    const ControlFlowGraph graph{*program};
+    auto const& blocks{graph.blocks()};
+    ASSERT_EQ(blocks.size(), 6u);
+    EXPECT_FALSE(graph.has_dynamic_jumps());
+
+    // mov | inc, cmp + jl | jl absorbed by the fused op | call | end | msg, ret
+    const std::vector<std::uint32_t> begins{0, 1, 3, 4, 5, 6};
+    for (std::size_t block{0}; block < blocks.size(); ++block)
+    {
+        EXPECT_EQ(blocks[block].begin, begins[block]);
+    }
+    EXPECT_EQ(blocks[5].end, 8u);
+    EXPECT_EQ(graph.block_of(2), 1u);
+    EXPECT_THAT(blocks[0].successors, ElementsAre(1));
+    EXPECT_THAT(blocks[1].successors, UnorderedElementsAre(1, 3));
+    EXPECT_THAT(blocks[3].successors, UnorderedElementsAre(5, 4));
+    EXPECT_TRUE(blocks[4].successors.empty());
+    EXPECT_TRUE(blocks[5].successors.empty());
+    EXPECT_THAT(blocks[1].predecessors, UnorderedElementsAre(0, 1, 2));
+    EXPECT_THAT(graph.reachable_blocks(), ElementsAre(true, true, false, true, true, true));
+}
+
+TEST(ControlFlowGraphTest, JumpsToRegisterDistancesCanReachEveryOp)
+{
+    const auto program{compile("mov a, 1\nmov b, 2\njnz a, b\ninc a\nend\n")};
+    const ControlFlowGraph graph{*program};
+    EXPECT_TRUE(graph.has_dynamic_jumps());
+    ASSERT_EQ(graph.blocks().size(), program->code.size());
+    EXPECT_EQ(graph.blocks()[2].successors.size(), graph.blocks().size());
+}
+
+TEST(ControlFlowGraphTest, CodeBehindEndIsUnreachable)
+{
+    const auto program{compile("mov a, 1\nend\ninc a\njmp done\ndone:\nret\n")};
+    const ControlFlowGraph graph{*program};
+    EXPECT_THAT(graph.reachable_blocks(), ElementsAre(true, false, false));
+}
@@ -0,0 +1,92 @@
+#include <string>
+#include <string_view>
+#include "assembler_interpreter/src/machine.h"
+#include "assembler_interpreter/src/program_cache.h"
+#include "gtest/gtest.h"
+
+namespace
+{
+const std::string overwritten_registers{R"(
+mov a, 1
+mov a, 2
+mov b, 3
+end
+unused:
+    mov c, 4
+    ret
+)"};
+}  // namespace
+
+TEST(DeadCodeEliminationTest, IsOffUnlessEnabled)
+{
+    Machine machine{};
+    machine.load_program(std::string_view{overwritten_registers});
+    EXPECT_EQ(machine.eliminated_instructions(), 0u);
+    EXPECT_EQ(machine.compiled_program()->code.size(), 6u);
+    EXPECT_EQ(ProgramCache{1}.get(overwritten_registers)->code.size(), 6u);
+}
+
+TEST(DeadCodeEliminationTest, KeepsTheRegistersARunEndsWith)
+{
+    Machine machine{};
+    machine.set_dead_code_elimination(DeadCodeElimination::KeepRegisters);
+    machine.load_program(std::string_view{overwritten_registers});
+    EXPECT_EQ(machine.eliminated_instructions(), 3u);
+    EXPECT_EQ(machine.compiled_program()->code.size(), 3u);
+    machine.run_program();
+    EXPECT_EQ(machine.get_registers(), (Registers{{"a", 2}, {"b", 3}}));
+}
+
+TEST(DeadCodeEliminationTest, OutputOnlyDropsEveryUnreadWrite)
+{
+    Machine machine{};
+    machine.set_dead_code_elimination(DeadCodeElimination::OutputOnly);
+    machine.load_program(std::string_view{overwritten_registers});
+    EXPECT_EQ(machine.eliminated_instructions(), 5u);
+    ASSERT_EQ(machine.compiled_program()->code.size(), 1u);
+    EXPECT_EQ(machine.compiled_program()->code.front().code, OpCode::End);
+    machine.run_program();
+    EXPECT_EQ(machine.flush(), "");
+}
+
+TEST(DeadCodeEliminationTest, WritesReadAfterAReturnStay)
+{
+    Machine machine{};
+    machine.set_engine(ExecutionEngine::Bytecode);
+    machine.set_dead_code_elimination(DeadCodeElimination::OutputOnly);
+    machine.load_program(std::string_view{R"(
+mov a, 1
+call set
+msg 'a = ', a
+end
+set:
+    mov b, 5
+    mov c, 9
+    mov a, b
+    ret
+)"});
+    EXPECT_EQ(machine.eliminated_instructions(), 2u);
+    machine.run_program();
+    EXPECT_EQ(machine.flush(), "a = 5");
+}
+
+TEST(DeadCodeEliminationTest, DivisionsThatCanTrapStay)
+{
+    Machine machine{};
+    machine.set_dead_code_elimination(DeadCodeElimination::OutputOnly);
+    machine.load_program(std::string_view{"mov a, 1\ndiv a, 0\nmov b, 8\ndiv b, 2\nend\n"});
+    EXPECT_EQ(machine.eliminated_instructions(), 2u);
+    EXPECT_EQ(machine.compiled_program()->code.size(), 3u);
+}
+
+TEST(DeadCodeEliminationTest, FoldedProgramsShrinkToTheirOutput)
+{
+    Machine machine{};
+    machine.set_constant_propagation(true);
+    machine.set_dead_code_elimination(DeadCodeElimination::OutputOnly);
+    machine.load_program(std::string_view{"mov a, 5\nadd a, 3\nmul a, 2\nmsg 'a = ', a\nend\n"});
+    EXPECT_EQ(machine.eliminated_instructions(), 3u);
+    EXPECT_EQ(machine.compiled_program()->code.size(), 2u);
+    machine.run_program();
+    EXPECT_EQ(machine.flush(), "a = 16");
+}
@@ -0,0 +1,447 @@
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "assembler_interpreter/src/assembler_main.h"
+#include "assembler_interpreter/src/machine.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+class ExecutionEngineTest : public ::testing::TestWithParam<ExecutionEngine>
+{
+};
+
+TEST_P(ExecutionEngineTest, RelativeJumpCountsLabels)
+{
+    std::string program{R"(
+mov a, 3
+mov c, 0
+loop:
+    inc c
+    dec a
+    jnz a, -2
+msg 'c = ', c
+end
+)"};
+    EXPECT_EQ(assembler_interpreter(program, GetParam()), "c = 3");
+}
+
+TEST_P(ExecutionEngineTest, RelativeJumpWithRegisterDistance)
+{
+    std::string program{R"(
+mov a, 3
+mov b, -2
+mov c, 0
+inc c
+dec a
+jnz a, b
+msg 'c = ', c
+end
+)"};
+    EXPECT_EQ(assembler_interpreter(program, GetParam()), "c = 3");
+}
+
+TEST_P(ExecutionEngineTest, OutOfRangeJumpSkipsNextInstruction)
+{
+    std::string program{R"(
+mov a, 1
+jnz a, 10
+mov a, 2
+msg 'a = ', a
+end
+)"};
+    EXPECT_EQ(assembler_interpreter(program, GetParam()), "a = 1");
+}
+
+TEST_P(ExecutionEngineTest, JumpOnePastTheLastInstructionEndsWithoutEnd)
+{
+    std::string program{R"(
+mov a, 1
+jnz a, 3
+end
+)"};
+    EXPECT_EQ(assembler_interpreter(program, GetParam()), "-1");
+}
+
+TEST_P(ExecutionEngineTest, UnwrittenRegistersReadAsZero)
+{
+    const std::string program{R"(
+mov a, b
+cmp c, 0
+jne skip
+msg 'a = ', a, ', d = ', d
+end
+skip:
+end
+)"};
+    Machine machine{};
+    machine.set_engine(GetParam());
+    machine.load_program(std::string_view{program});
+    EXPECT_EQ(machine.run_program(), RunStatus::Ended);
+    EXPECT_EQ(machine.flush(), "a = 0, d = 0");
+    EXPECT_THAT(machine.get_registers(), ::testing::ContainerEq(Registers{{"a", 0}}));
+}
+
+TEST_P(ExecutionEngineTest, JumpIntoSecondInstructionOfComparePair)
+{
+    std::string program{R"(
+mov a, 0
+mov b, 0
+cmp a, 1
+jmp second
+again:
+    cmp a, 0
+second:
+    jl less
+    inc b
+    jmp finish
+less:
+    inc a
+    inc b
+    jmp again
+finish:
+    msg 'a = ', a, ', b = ', b
+    end
+)"};
+    EXPECT_EQ(assembler_interpreter(program, GetParam()), "a = 1, b = 2");
+}
+
+TEST_P(ExecutionEngineTest, FlagsOfFusedCompareSurviveTheJump)
+{
+    std::string program{R"(
+mov a, 3
+cmp a, 2
+jl never
+jg greater
+msg 'not greater'
+end
+greater:
+    msg 'greater'
+    end
+never:
+    msg 'less'
+    end
+)"};
+    EXPECT_EQ(assembler_interpreter(program, GetParam()), "greater");
+}
+
+TEST_P(ExecutionEngineTest, FlagsOutliveLaterInstructionsAndCalls)
+{
+    std::string program{R"(
+jne no_compare_yet
+je no_compare_yet
+mov a, 4
+cmp a, 7
+mov a, 9
+call change_operands
+jge wrong
+jle less_or_equal
+wrong:
+    msg 'wrong'
+    end
+less_or_equal:
+    jl less
+    msg 'not less'
+    end
+less:
+    msg 'less, a = ', a
+    end
+change_operands:
+    mul a, 2
+    ret
+no_compare_yet:
+    msg 'jumped without a comparison'
+    end
+)"};
+    EXPECT_EQ(assembler_interpreter(program, GetParam()), "less, a = 18");
+}
+
+TEST_P(ExecutionEngineTest, Factorial)
+{
+    std::string program{R"(
+mov   a, 5
+mov   b, a
+mov   c, a
+call  proc_fact
+call  print
+end
+
+proc_fact:
+    dec   b
+    mul   c, b
+    cmp   b, 1
+    jne   proc_fact
+    ret
+
+print:
+    msg   a, '! = ', c ; output text
+    ret
+)"};
+    EXPECT_EQ(assembler_interpreter(program, GetParam()), "5! = 120");
+}
+
+TEST_P(ExecutionEngineTest, Fibonacci)
+{
+    std::string program{R"(
+mov   a, 8            ; value
+mov   b, 0            ; next
+mov   c, 0            ; counter
+mov   d, 0            ; first
+mov   e, 1            ; second
+call  proc_fib
+call  print
+end
+
+proc_fib:
+    cmp   c, 2
+    jl    func_0
+    mov   b, d
+    add   b, e
+    mov   d, e
+    mov   e, b
+    inc   c
+    cmp   c, a
+    jle   proc_fib
+    ret
+
+func_0:
+    mov   b, c
+    inc   c
+    jmp   proc_fib
+
+print:
+    msg   'Term ', a, ' of Fibonacci series is: ', b        ; output text
+    ret)"};
+    EXPECT_EQ(assembler_interpreter(program, GetParam()), "Term 8 of Fibonacci series is: 21");
+}
+
+TEST_P(ExecutionEngineTest, Power)
+{
+    std::string program{R"(
+mov   a, 2            ; value1
+mov   b, 10           ; value2
+mov   c, a            ; temp1
+mov   d, b            ; temp2
+call  proc_func
+call  print
+end
+
+proc_func:
+    cmp   d, 1
+    je    continue
+    mul   c, a
+    dec   d
+    call  proc_func
+
+continue:
+    ret
+
+print:
+    msg a, '^', b, ' = ', c
+    ret)"};
+    EXPECT_EQ(assembler_interpreter(program, GetParam()), "2^10 = 1024");
+}
+
+TEST_P(ExecutionEngineTest, MissingEndReturnsDefault)
+{
+    std::string program{R"(
+call  func1
+call  print
+end
+
+func1:
+    call  func2
+    ret
+
+func2:
+    ret
+
+print:
+    msg 'This program should return -1')"};
+    EXPECT_EQ(assembler_interpreter(program, GetParam()), "-1");
+}
+
+TEST_P(ExecutionEngineTest, CountingLoopWithInvariantStep)
+{
+    std::string program{R"(
+mov b, 5
+loop:
+    inc a
+    add c, b
+    sub d, 2
+    cmp a, 100000
+    jl loop
+je done
+msg 'flags lost'
+end
+done:
+msg a, ' ', c, ' ', d
+end
+)"};
+    EXPECT_EQ(assembler_interpreter(program, GetParam()), "100000 500000 -200000");
+}
+
+TEST_P(ExecutionEngineTest, CountingLoopWithBoundOnTheLeft)
+{
+    std::string program{R"(
+mov b, 10
+loop:
+    add a, 3
+    cmp b, a
+    jg loop
+msg 'a = ', a
+end
+)"};
+    EXPECT_EQ(assembler_interpreter(program, GetParam()), "a = 12");
+}
+
+TEST_P(ExecutionEngineTest, NestedCountingLoops)
+{
+    std::string program{R"(
+mov a, 300
+outer:
+    mov b, 10
+inner:
+    add c, b
+    dec b
+    jnz b, -2
+    dec a
+    cmp a, 0
+    jne outer
+msg 'c = ', c
+end
+)"};
+    EXPECT_EQ(assembler_interpreter(program, GetParam()), "c = 16500");
+}
+
+TEST_P(ExecutionEngineTest, MessageFormatsExtremeValuesAndAdjacentText)
+{
+    std::string program{R"(
+mov a, -2147483648
+mov b, 2147483647
+msg a, b, '', ' and ', 'then ', 0, ' or ', -7
+end
+)"};
+    EXPECT_EQ(assembler_interpreter(program, GetParam()), "-21474836482147483647 and then 0 or -7");
+}
+
+TEST_P(ExecutionEngineTest, FlushingAgainReturnsTheSameOutput)
+{
+    Machine machine{};
+    machine.set_engine(GetParam());
+    machine.load_program(std::string_view{"mov a, 6\nmsg 'a = ', a\nend\n"});
+    machine.run_program();
+    EXPECT_EQ(machine.flush(), "a = 6");
+    EXPECT_EQ(machine.flush(), "a = 6");
+    EXPECT_EQ(&machine.flush(), &machine.flush());
+}
+
+TEST_P(ExecutionEngineTest, MachineRunsAgainWithSeededRegisters)
+{
+    Machine machine{};
+    machine.set_engine(GetParam());
+    machine.load_program(std::string_view{R"(
+    mov b, a
+    mul b, a
+    cmp b, 10
+    jl small
+    msg a, ' squared is ', b
+    end
+small:
+    msg 'too small'
+)"});
+    machine.set_register("a", 4);
+    machine.run_program();
+    EXPECT_EQ(machine.flush(), "4 squared is 16");
+
+    machine.set_register("a", 3);
+    machine.run_program();
+    EXPECT_EQ(machine.flush(), "-1");
+
+    machine.reset();
+    machine.set_register("a", 5);
+    machine.run_program();
+    EXPECT_EQ(machine.flush(), "5 squared is 25");
+    EXPECT_THROW(machine.set_register("z", 1), std::out_of_range);
+}
+
+TEST_P(ExecutionEngineTest, RecursionDeeperThanTheReturnStackStops)
+{
+    const std::string program{R"(
+mov a, 1000
+call recurse
+msg 'b = ', b
+end
+recurse:
+    dec a
+    jnz a, 2
+    ret
+    call recurse
+    inc b
+    ret
+)"};
+    Machine machine{};
+    machine.set_engine(GetParam());
+    machine.set_execution_limits({0, 100});
+    machine.load_program(std::string_view{program});
+    EXPECT_EQ(machine.run_program(), RunStatus::CallDepthLimit);
+    EXPECT_EQ(machine.get_registers().at("a"), 900);
+
+    machine.set_execution_limits({0, 1000});
+    EXPECT_EQ(machine.run_program(), RunStatus::Ended);
+    EXPECT_EQ(machine.flush(), "b = 999");
+}
+
+TEST_P(ExecutionEngineTest, RecursionWithoutCallDepthLimitGrowsTheReturnStack)
+{
+    const std::string program{R"(
+mov a, 1100000
+mov b, 0
+call recurse
+msg 'b = ', b
+end
+recurse:
+    dec a
+    jnz a, 2
+    ret
+    call recurse
+    inc b
+    ret
+)"};
+    EXPECT_EQ(assembler_interpreter(program, GetParam()), "b = 1099999");
+}
+
+INSTANTIATE_TEST_CASE_P(Engines,
+                        ExecutionEngineTest,
+                        ::testing::Values(ExecutionEngine::Reference,
+                                          ExecutionEngine::Bytecode,
+                                          ExecutionEngine::Threaded,
+                                          ExecutionEngine::Jit));
+
+// The reference engine runs the program as written, tail calls are eliminated in the compiled form only.
+TEST(TailCallTest, TailRecursionRunsInConstantStackSpace)
+{
+    const std::string program{R"(
+mov a, 100000
+call countdown
+msg 'a = ', a, ', b = ', b
+end
+countdown:
+    dec a
+    inc b
+    cmp a, 0
+    je done
+    call countdown
+done:
+    ret
+)"};
+    for (auto engine : {ExecutionEngine::Bytecode, ExecutionEngine::Threaded, ExecutionEngine::Jit})
+    {
+        Machine machine{};
+        machine.set_engine(engine);
+        machine.set_execution_limits({0, 2});
+        machine.load_program(std::string_view{program});
+        EXPECT_EQ(machine.run_program(), RunStatus::Ended);
+        EXPECT_EQ(machine.flush(), "a = 0, b = 100000");
+    }
+}
@@ -0,0 +1,76 @@
+#include <chrono>
+#include <string>
+#include <string_view>
+#include "assembler_interpreter/src/machine.h"
+#include "assembler_interpreter/src/trace.h"
+#include "gtest/gtest.h"
+
+namespace
+{
+const std::string endless_loop{R"(
+mov a, 1
+mov b, 0
+loop:
+    inc b
+    jnz a, -1
+end
+)"};
+
+const std::string runaway_recursion{R"(
+mov a, 0
+recurse:
+    inc a
+    call recurse
+end
+)"};
+}  // namespace
+
+TEST(ExecutionLimitsTest, InstructionBudgetStopsEndlessLoop)
+{
+    Machine machine{};
+    machine.set_execution_limits({1000});
+    machine.load_program(std::string_view{endless_loop});
+    EXPECT_EQ(machine.run_program(), RunStatus::InstructionLimit);
+    EXPECT_EQ(machine.flush(), "-1");
+    EXPECT_GE(machine.executed_instructions(), 1000u);
+    EXPECT_LE(machine.executed_instructions(), 1002u);
+    EXPECT_EQ(machine.get_registers().at("b"), 499);
+}
+
+TEST(ExecutionLimitsTest, CallDepthStopsRunawayRecursion)
+{
+    Machine machine{};
+    machine.set_execution_limits({0, 64});
+    machine.load_program(std::string_view{runaway_recursion});
+    EXPECT_EQ(machine.run_program(), RunStatus::CallDepthLimit);
+    EXPECT_EQ(machine.get_registers().at("a"), 65);
+}
+
+TEST(ExecutionLimitsTest, WallTimeStopsEndlessLoop)
+{
+    TraceBuffer trace{16};
+    Machine machine{};
+    machine.set_trace_buffer(&trace);
+    machine.set_execution_limits({0, 0, std::chrono::milliseconds{20}});
+    machine.load_program(std::string_view{endless_loop});
+    const auto start{std::chrono::steady_clock::now()};
+    EXPECT_EQ(machine.run_program(), RunStatus::TimeLimit);
+    EXPECT_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds{20});
+    EXPECT_EQ(trace.recorded(), machine.executed_instructions());
+}
+
+TEST(ExecutionLimitsTest, ProgramsWithinLimitsRunToTheirEnd)
+{
+    Machine machine{};
+    machine.set_execution_limits({1000, 4, std::chrono::seconds{10}});
+    machine.load_program(
+        std::string_view{"mov a, 5\ncall double\nmsg 'a = ', a\nend\ndouble:\n    add a, a\n    ret\n"});
+    EXPECT_EQ(machine.run_program(), RunStatus::Ended);
+    EXPECT_EQ(machine.flush(), "a = 10");
+
+    Machine unended{};
+    unended.set_execution_limits({1000});
+    unended.load_program(std::string_view{"mov a, 5\n"});
+    EXPECT_EQ(unended.run_program(), RunStatus::Finished);
+    EXPECT_EQ(unended.flush(), "-1");
+}
@@ -0,0 +1,170 @@
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "assembler_interpreter/src/lockstep.h"
+#include "assembler_interpreter/src/machine.h"
+#include "gtest/gtest.h"
+
+namespace
+{
+template <typename Word>
+using Seeds = std::vector<std::pair<std::string, std::vector<Word>>>;
+
+// Runs program once over every lane and once per lane on a Machine, and expects the same outcome from both.
+template <typename Word>
+void expect_lanes_match_machines(std::string_view program, Seeds<Word> const& seeds, bool simd,
+                                 std::size_t max_call_depth = 0)
+{
+    const auto lanes{seeds.front().second.size()};
+    BasicLockstepMachine<Word> lockstep{lanes};
+    lockstep.set_simd(simd);
+    lockstep.set_max_call_depth(max_call_depth);
+    lockstep.load_program(program);
+    for (auto const& seed : seeds)
+    {
+        lockstep.set_register(seed.first, seed.second);
+    }
+    lockstep.run_program();
+
+    ExecutionLimits limits{};
+    limits.max_call_depth = max_call_depth;
+    for (std::size_t lane{0}; lane < lanes; ++lane)
+    {
+        BasicMachine<Word> machine{};
+        machine.set_execution_limits(limits);
+        machine.load_program(program);
+        for (auto const& seed : seeds)
+        {
+            machine.set_register(seed.first, seed.second[lane]);
+        }
+        EXPECT_EQ(lockstep.status(lane), machine.run_program()) << "lane " << lane;
+        EXPECT_EQ(lockstep.get_registers(lane), machine.get_registers()) << "lane " << lane;
+        EXPECT_EQ(lockstep.flush(lane), machine.flush()) << "lane " << lane;
+    }
+}
+}  // namespace
+
+class LockstepTest : public ::testing::TestWithParam<bool>
+{
+};
+
+TEST_P(LockstepTest, LanesLeaveLoopsAfterTheirOwnTrips)
+{
+    expect_lanes_match_machines<std::int32_t>(R"(
+    mov f, 1
+    mov i, 0
+loop:
+    inc i
+    mul f, i
+    cmp i, n
+    jl loop
+    msg n, '! = ', f
+    end
+)",
+                                              {{"n", {1, 5, 3, 12, 0, 7, 7, 2, 10, 4, 1, 9, 6}}}, GetParam());
+    expect_lanes_match_machines<std::int32_t>(
+        "mov a, 0\nloop:\n    add a, 3\n    dec b\n    jnz b, -2\nmsg 'a = ', a\nend\n",
+        {{"b", {4, 1, 9, 2, 2, 7, 3, 5, 1, 1, 8}}}, GetParam());
+}
+
+TEST_P(LockstepTest, LanesTakeTheirOwnPaths)
+{
+    expect_lanes_match_machines<std::int32_t>(R"(
+    cmp a, b
+    jg greater
+    je equal
+    sub b, a
+    msg 'less by ', b
+    end
+greater:
+    mov c, a
+    div c, b
+    msg 'greater ', c
+    end
+equal:
+    ret
+)",
+                                              {{"a", {1, 9, 4, -7, 2147483647, 3, 6, 0, 12}},
+                                               {"b", {2, 3, 4, -8, -2147483647, 3, 1, 0, 5}}},
+                                              GetParam());
+    expect_lanes_match_machines<std::int32_t>("mov c, 5\njnz a, d\ninc c\ninc c\ninc c\nmsg 'c = ', c\nend\n",
+                                              {{"a", {0, 1, 1, 1, 1, 1}}, {"d", {1, 2, 3, 4, -9, 40}}},
+                                              GetParam());
+}
+
+TEST_P(LockstepTest, RecursionDepthsDifferPerLane)
+{
+    const std::string_view program{R"(
+    mov r, 0
+    call fib
+    msg 'fib(', n, ') = ', r
+    end
+fib:
+    cmp n, 2
+    jl small
+    dec n
+    call fib
+    dec n
+    call fib
+    add n, 2
+    ret
+small:
+    add r, n
+    ret
+)"};
+    expect_lanes_match_machines<std::int32_t>(program, {{"n", {0, 1, 2, 7, 12, 5, 3, 9, 4}}}, GetParam());
+    expect_lanes_match_machines<std::int32_t>(program, {{"n", {3, 8, 4, 12, 1, 6, 2, 10, 5}}}, GetParam(), 6);
+}
+
+TEST_P(LockstepTest, WideLanesComputeBeyondThirtyTwoBits)
+{
+    expect_lanes_match_machines<std::int64_t>(R"(
+    mov f, 1
+loop:
+    cmp n, 1
+    jle done
+    mul f, n
+    dec n
+    jmp loop
+done:
+    mov q, f
+    div q, 3
+    msg f, ' ', q
+    end
+)",
+                                              {{"n", {20, 1, 13, 15, 2, 19, 17}}}, GetParam());
+}
+
+TEST_P(LockstepTest, DivisionByMinusOneWrapsPerLane)
+{
+    const std::string_view program{"div a, b\nmsg a\nend\n"};
+    expect_lanes_match_machines<std::int32_t>(
+        program, {{"a", {-2147483647 - 1, 7, -7, 9}}, {"b", {-1, -1, 2, 3}}}, GetParam());
+    expect_lanes_match_machines<std::int64_t>(
+        program, {{"a", {std::numeric_limits<std::int64_t>::min(), 7, -7, 9}}, {"b", {-1, -1, 2, 3}}}, GetParam());
+}
+
+INSTANTIATE_TEST_CASE_P(Kernels, LockstepTest, ::testing::Bool());
+
+TEST(LockstepTest, RegistersAreSeededPerLane)
+{
+    LockstepMachine lockstep{3};
+    lockstep.load_program(std::string_view{"inc a\nmsg 'a = ', a\nend\n"});
+    EXPECT_THROW(lockstep.set_register("a", {1, 2}), std::invalid_argument);
+    EXPECT_THROW(lockstep.set_register("b", {1, 2, 3}), std::out_of_range);
+    lockstep.set_register("a", {1, 2, 3});
+    lockstep.run_program();
+    EXPECT_EQ(lockstep.flush(2), "a = 4");
+    EXPECT_EQ(lockstep.flush(2), "a = 4");
+    EXPECT_EQ(&lockstep.flush(2), &lockstep.flush(2));
+    lockstep.run_program();
+    EXPECT_EQ(lockstep.flush(0), "a = 2");
+    lockstep.reset();
+    lockstep.run_program();
+    EXPECT_EQ(lockstep.flush(1), "a = 1");
+    EXPECT_EQ(lockstep.status(1), RunStatus::Ended);
+}
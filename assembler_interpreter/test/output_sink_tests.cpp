@@ -0,0 +1,98 @@
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include "assembler_interpreter/src/assembler_main.h"
+#include "assembler_interpreter/src/machine.h"
+#include "assembler_interpreter/src/output_sink.h"
+#include "gtest/gtest.h"
+
+namespace
+{
+const std::string counting_loop{R"(
+mov a, 2000
+print:
+    msg 'value ', a, '; '
+    dec a
+    cmp a, 0
+    jne print
+)"};
+const std::string counting_program{counting_loop + "end\n"};
+const std::string unfinished_program{"mov a, 7\nmsg 'a = ', a\n"};
+
+std::string run_with_sink(std::string const& program, OutputSink& sink, ExecutionEngine engine)
+{
+    Machine machine{};
+    machine.set_engine(engine);
+    machine.set_output_sink(&sink);
+    machine.load_program(std::string_view{program});
+    machine.run_program();
+    return machine.flush();
+}
+}  // namespace
+
+TEST(OutputSinkTest, CallbackSeesTheWholeOutputInChunks)
+{
+    const auto expected{assembler_interpreter(counting_program)};
+    for (auto engine :
+         {ExecutionEngine::Reference, ExecutionEngine::Bytecode, ExecutionEngine::Threaded, ExecutionEngine::Jit})
+    {
+        std::string output{};
+        int chunks{0};
+        int commits{0};
+        CallbackSink sink{[&](std::string_view text) {
+                              output.append(text);
+                              ++chunks;
+                          },
+                          [&](bool committed) { commits += committed ? 1 : -1; }};
+        EXPECT_EQ(run_with_sink(counting_program, sink, engine), "");
+        EXPECT_EQ(output, expected);
+        EXPECT_GT(chunks, 1);
+        EXPECT_EQ(commits, 1);
+    }
+}
+
+TEST(OutputSinkTest, ExceptionsOfTheSinkLeaveTheRun)
+{
+    for (auto engine :
+         {ExecutionEngine::Reference, ExecutionEngine::Bytecode, ExecutionEngine::Threaded, ExecutionEngine::Jit})
+    {
+        CallbackSink sink{[](std::string_view) { throw std::runtime_error{"sink failed"}; }};
+        Machine machine{};
+        machine.set_engine(engine);
+        machine.set_output_sink(&sink);
+        machine.load_program(std::string_view{counting_program});
+        EXPECT_THROW(machine.run_program(), std::runtime_error);
+    }
+}
+
+TEST(OutputSinkTest, RingBufferKeepsTheEndOfTheOutput)
+{
+    const auto expected{assembler_interpreter(counting_program)};
+    RingBufferSink sink{100};
+    run_with_sink(counting_program, sink, ExecutionEngine::Threaded);
+    EXPECT_EQ(sink.contents(), expected.substr(expected.size() - 100));
+    EXPECT_TRUE(sink.truncated());
+
+    EXPECT_EQ(run_with_sink(unfinished_program, sink, ExecutionEngine::Threaded), "-1");
+    EXPECT_EQ(sink.contents(), "-1");
+
+    run_with_sink("end\n", sink, ExecutionEngine::Threaded);
+    EXPECT_EQ(sink.contents(), "");
+    EXPECT_FALSE(sink.truncated());
+}
+
+TEST(OutputSinkTest, FileDescriptorSinkTakesBackDiscardedRuns)
+{
+    auto* const file{std::tmpfile()};
+    ASSERT_NE(file, nullptr);
+    FileDescriptorSink sink{fileno(file)};
+    run_with_sink("mov a, 7\nmsg 'a = ', a\nend\n", sink, ExecutionEngine::Threaded);
+    run_with_sink(counting_loop, sink, ExecutionEngine::Threaded);
+
+    std::string contents(64, '\0');
+    std::rewind(file);
+    contents.resize(std::fread(contents.data(), 1, contents.size(), file));
+    std::fclose(file);
+    EXPECT_EQ(contents, "a = 7-1");
+}
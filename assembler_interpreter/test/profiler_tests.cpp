@@ -0,0 +1,129 @@
+#include <algorithm>
+#include <cstdint>
+#include <numeric>
+#include <string>
+#include <string_view>
+#include "assembler_interpreter/src/assembler_main.h"
+#include "assembler_interpreter/src/machine.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace
+{
+const std::string profiled_program{R"(
+mov   a, 200
+outer:
+    call  square
+    dec   a
+    cmp   a, 0
+    jne   outer
+msg   'b = ', b
+end
+
+square:
+    mov   b, a
+    mul   b, a
+    call  check
+    ret
+
+check:
+    cmp   b, 0
+    ret
+)"};
+
+SubroutineProfile const& subroutine(Profile const& profile, std::string_view name)
+{
+    return *std::find_if(profile.subroutines.begin(), profile.subroutines.end(), [name](auto const& subroutine) {
+        return subroutine.name == name;
+    });
+}
+}  // namespace
+
+TEST(ProfilerTest, CountsEveryOpAndCall)
+{
+    Machine machine{};
+    machine.set_profiling(true);
+    machine.load_program(std::string_view{profiled_program});
+    machine.run_program();
+    EXPECT_EQ(machine.flush(), "b = 1");
+
+    auto const& profile{machine.profile()};
+    EXPECT_EQ(subroutine(profile, "<main>").calls, 0u);
+    EXPECT_EQ(subroutine(profile, "square").calls, 200u);
+    EXPECT_EQ(subroutine(profile, "check").calls, 200u);
+
+    const auto square_mul{std::find_if(profile.ops.begin(), profile.ops.end(), [](auto const& op) {
+        return op.code == OpCode::Mul;
+    })};
+    ASSERT_NE(square_mul, profile.ops.end());
+    EXPECT_EQ(square_mul->label, "square");
+    EXPECT_EQ(square_mul->count, 200u);
+    EXPECT_EQ(square_mul->source_index, 10u);
+}
+
+TEST(ProfilerTest, TimeAddsUpAcrossOpsAndSubroutines)
+{
+    Machine machine{};
+    machine.set_profiling(true);
+    machine.load_program(std::string_view{profiled_program});
+    machine.run_program();
+
+    auto const& profile{machine.profile()};
+    const auto op_ticks{std::accumulate(
+        profile.ops.begin(), profile.ops.end(), std::uint64_t{0}, [](auto sum, auto& op) { return sum + op.ticks; })};
+    const auto exclusive_ticks{std::accumulate(
+        profile.subroutines.begin(), profile.subroutines.end(), std::uint64_t{0}, [](auto sum, auto& subroutine) {
+            return sum + subroutine.exclusive_ticks;
+        })};
+    EXPECT_EQ(op_ticks, profile.total_ticks);
+    EXPECT_EQ(exclusive_ticks, profile.total_ticks);
+    EXPECT_EQ(profile.subroutines.front().name, "<main>");
+    EXPECT_EQ(profile.subroutines.front().inclusive_ticks, profile.total_ticks);
+    EXPECT_GE(subroutine(profile, "square").inclusive_ticks, subroutine(profile, "check").inclusive_ticks);
+    EXPECT_TRUE(std::is_sorted(profile.ops.begin(), profile.ops.end(), [](auto const& lhs, auto const& rhs) {
+        return lhs.ticks > rhs.ticks;
+    }));
+    EXPECT_THAT(profile.report(5), ::testing::HasSubstr("square"));
+}
+
+TEST(ProfilerTest, TailRecursionKeepsTheStackBounded)
+{
+    Machine machine{};
+    machine.set_profiling(true);
+    machine.load_program(std::string_view{R"(
+mov   a, 100000
+call  count
+msg   'a = ', a
+end
+
+count:
+    dec   a
+    jnz   a, 2
+    ret
+    call  count
+    ret
+)"});
+    machine.run_program();
+    EXPECT_EQ(machine.flush(), "a = 0");
+    EXPECT_EQ(subroutine(machine.profile(), "count").calls, 100000u);
+
+    Profiler profiler{*machine.compiled_program(), {}};
+    profiler.call(4);
+    for (int call{0}; call < 100000; ++call)
+    {
+        profiler.tail_call(4);
+    }
+    EXPECT_EQ(profiler.depth(), 3u);
+    profiler.ret();
+    EXPECT_EQ(profiler.depth(), 1u);
+}
+
+TEST(ProfilerTest, DisabledProfilingRecordsNothing)
+{
+    Machine machine{};
+    machine.load_program(std::string_view{profiled_program});
+    machine.run_program();
+    EXPECT_EQ(machine.flush(), "b = 1");
+    EXPECT_TRUE(machine.profile().ops.empty());
+    EXPECT_EQ(machine.profile().total_ticks, 0u);
+}
@@ -0,0 +1,100 @@
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "assembler_interpreter/src/assembler_main.h"
+#include "assembler_interpreter/src/program_cache.h"
+#include "gtest/gtest.h"
+
+namespace
+{
+const std::string square_program{"mov a, 7\nmul a, a\nmsg 'a = ', a\nend\n"};
+const std::string cube_program{"mov a, 3\nmov b, a\nmul a, b\nmul a, b\nmsg 'a = ', a\nend\n"};
+const std::string sum_program{"mov a, 2\nadd a, 40\nmsg 'a = ', a\nend\n"};
+}  // namespace
+
+TEST(ProgramCacheTest, RepeatedSourceIsCompiledOnce)
+{
+    ProgramCache cache{4};
+    EXPECT_EQ(assembler_interpreter(square_program, cache), "a = 49");
+    EXPECT_EQ(assembler_interpreter(square_program, cache), "a = 49");
+    EXPECT_EQ(cache.get(square_program), cache.get(square_program));
+    EXPECT_EQ(cache.misses(), 1u);
+    EXPECT_EQ(cache.hits(), 3u);
+}
+
+TEST(ProgramCacheTest, LeastRecentlyUsedProgramIsEvicted)
+{
+    ProgramCache cache{2};
+    const auto square{cache.get(square_program)};
+    cache.get(cube_program);
+    cache.get(square_program);
+    cache.get(sum_program);
+    EXPECT_EQ(cache.size(), 2u);
+    EXPECT_EQ(cache.get(square_program), square);
+    EXPECT_NE(cache.get(cube_program), nullptr);
+    EXPECT_EQ(cache.misses(), 4u);
+}
+
+TEST(ProgramCacheTest, CompiledProgramIsSharedBetweenMachines)
+{
+    ProgramCache cache{1};
+    std::vector<std::string> outputs(8);
+    std::vector<std::thread> threads{};
+    for (auto& output : outputs)
+    {
+        threads.emplace_back([&cache, &output]() {
+            Machine machine{};
+            machine.set_engine(ExecutionEngine::Bytecode);
+            machine.load_program(cache.get(cube_program));
+            machine.run_program();
+            output = machine.flush();
+        });
+    }
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+    EXPECT_EQ(outputs, std::vector<std::string>(8, "a = 27"));
+}
+
+TEST(ProgramCacheTest, NativeCodeIsSharedBetweenMachines)
+{
+    ProgramCache cache{1};
+    std::vector<std::string> outputs(8);
+    std::vector<std::thread> threads{};
+    for (auto& output : outputs)
+    {
+        threads.emplace_back([&cache, &output]() {
+            Machine machine{};
+            machine.set_engine(ExecutionEngine::Jit);
+            machine.load_program(cache.get(cube_program));
+            machine.run_program();
+            output = machine.flush();
+        });
+    }
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+    EXPECT_EQ(outputs, std::vector<std::string>(8, "a = 27"));
+#if defined(__x86_64__) && (defined(__linux__) || defined(__APPLE__))
+    int translations{0};
+    cache.get(cube_program)->native_code.get(sizeof(std::int32_t), [&translations]() {
+        ++translations;
+        return std::shared_ptr<JitCode>{};
+    });
+    EXPECT_EQ(translations, 0);
+#endif
+}
+
+TEST(ProgramCacheTest, ReferenceEngineRunsCompiledProgram)
+{
+    ProgramCache cache{1};
+    Machine machine{};
+    machine.set_engine(ExecutionEngine::Reference);
+    machine.load_program(cache.get(sum_program));
+    machine.run_program();
+    EXPECT_EQ(machine.flush(), "a = 42");
+}
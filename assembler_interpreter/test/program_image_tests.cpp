@@ -0,0 +1,97 @@
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include "assembler_interpreter/src/assembler_main.h"
+#include "assembler_interpreter/src/machine.h"
+#include "assembler_interpreter/src/program_image.h"
+#include "gtest/gtest.h"
+
+namespace
+{
+const std::string image_program{R"(
+mov   a, 5
+mov   b, a
+mov   c, a
+call  proc_fact
+mov   d, 3
+loop:
+    add e, 2
+    dec d
+    jnz d, -2
+call  print
+end
+
+proc_fact:
+    dec   b
+    mul   c, b
+    cmp   b, 1
+    jne   proc_fact
+    ret
+
+print:
+    msg   a, '! = ', c, ', e = ', e
+    ret
+)"};
+
+CompiledProgram compile(std::string const& source)
+{
+    Machine machine{};
+    machine.load_program(std::string_view{source});
+    return machine.compiled_program();
+}
+
+std::string run(CompiledProgram program, ExecutionEngine engine)
+{
+    Machine machine{};
+    machine.set_engine(engine);
+    machine.load_program(std::move(program));
+    machine.run_program();
+    return machine.flush();
+}
+}  // namespace
+
+TEST(ProgramImageTest, DecodedProgramRunsOnEveryEngine)
+{
+    const auto program{compile(image_program)};
+    ASSERT_FALSE(program->loops.empty());
+    const auto decoded{decode_program_image(encode_program_image(*program))};
+    EXPECT_EQ(encode_program_image(*decoded), encode_program_image(*program));
+    for (auto engine :
+         {ExecutionEngine::Reference, ExecutionEngine::Bytecode, ExecutionEngine::Threaded, ExecutionEngine::Jit})
+    {
+        EXPECT_EQ(run(decoded, engine), "5! = 120, e = 6");
+    }
+}
+
+TEST(ProgramImageTest, MappedFileLoadsWithoutSource)
+{
+    const std::string path{testing::TempDir() + "program_image_test.bin"};
+    write_program_image(*compile(image_program), path);
+    EXPECT_EQ(run(load_program_image(path), ExecutionEngine::Threaded), "5! = 120, e = 6");
+    std::remove(path.c_str());
+    EXPECT_THROW(load_program_image(path), std::runtime_error);
+}
+
+TEST(ProgramImageTest, DamagedImagesAreRejected)
+{
+    const auto image{encode_program_image(*compile(image_program))};
+    EXPECT_THROW(decode_program_image({}), std::runtime_error);
+    EXPECT_THROW(decode_program_image(std::string_view{image}.substr(0, image.size() - 1)), std::runtime_error);
+    EXPECT_THROW(decode_program_image(image + '\0'), std::runtime_error);
+
+    auto other_version{image};
+    ++other_version[4];
+    EXPECT_THROW(decode_program_image(other_version), std::runtime_error);
+
+    // The first op follows the header and the slots, its first operand is a slot for every opcode.
+    const auto program{compile(image_program)};
+    std::size_t first_op{20 + 4};
+    for (auto const& name : program->slot_names)
+    {
+        first_op += 12 + name.size();
+    }
+    auto bad_operand{image};
+    bad_operand.replace(first_op + 4 + 4, 4, "\xff\xff\xff\x7f", 4);
+    EXPECT_THROW(decode_program_image(bad_operand), std::runtime_error);
+}
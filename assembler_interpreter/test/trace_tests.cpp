@@ -0,0 +1,88 @@
+#include <string>
+#include <string_view>
+#include <thread>
+#include "assembler_interpreter/src/machine.h"
+#include "assembler_interpreter/src/trace.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace
+{
+const std::string traced_program{R"(
+mov a, 3
+loop:
+    mul a, 2
+    cmp a, 20
+    jl loop
+msg 'a = ', a
+end
+)"};
+}  // namespace
+
+TEST(TraceTest, RecordsEveryExecutedOp)
+{
+    TraceBuffer trace{64};
+    Machine machine{};
+    machine.set_trace_buffer(&trace);
+    machine.load_program(std::string_view{traced_program});
+    machine.run_program();
+    EXPECT_EQ(machine.flush(), "a = 24");
+
+    const auto records{trace.snapshot()};
+    ASSERT_EQ(records.size(), 9u);
+    EXPECT_EQ(trace.recorded(), 9u);
+    EXPECT_EQ(records[0].code, static_cast<std::uint8_t>(OpCode::Mov));
+    EXPECT_EQ(records[0].value, 3);
+    EXPECT_EQ(records[2].code, static_cast<std::uint8_t>(OpCode::CmpJl));
+    EXPECT_EQ(records[2].slot, TraceRecord::no_slot);
+    EXPECT_EQ(records[2].flags, Less | LessOrEqual | NotEqual);
+    EXPECT_EQ(records[6].flags, Greater | GreaterOrEqual | NotEqual);
+
+    const auto program{machine.compiled_program()};
+    EXPECT_EQ(format_trace(records, *program),
+              "0 mov a=3\n1 mul a=6\n2 cmp+jl [<]\n1 mul a=12\n2 cmp+jl [<]\n1 mul a=24\n2 cmp+jl [>]\n"
+              "4 msg\n5 end\n");
+}
+
+TEST(TraceTest, RingKeepsTheLatestRecords)
+{
+    TraceBuffer trace{5};
+    EXPECT_EQ(trace.capacity(), 8u);
+    Machine machine{};
+    machine.set_trace_buffer(&trace);
+    machine.load_program(std::string_view{"mov a, 0\ninc a\ninc a\ninc a\ninc a\ninc a\ninc a\ninc a\ninc a\ninc a\n"
+                                          "end\n"});
+    machine.run_program();
+
+    const auto records{trace.snapshot()};
+    EXPECT_EQ(trace.recorded(), 11u);
+    ASSERT_EQ(records.size(), 8u);
+    EXPECT_EQ(records.front().value, 3);
+    EXPECT_EQ(records[6].value, 9);
+    EXPECT_EQ(records.back().code, static_cast<std::uint8_t>(OpCode::End));
+}
+
+TEST(TraceTest, SnapshotWhileRunningHoldsConsecutiveRecords)
+{
+    TraceBuffer trace{256};
+    Machine machine{};
+    machine.set_trace_buffer(&trace);
+    machine.set_loop_collapsing(false);
+    machine.load_program(std::string_view{"mov a, 0\nloop:\n    inc a\n    cmp a, 200000\n    jl loop\nend\n"});
+    std::thread runner{[&machine]() { machine.run_program(); }};
+    while (trace.recorded() == 0)
+    {
+        std::this_thread::yield();
+    }
+    const auto records{trace.snapshot()};
+    runner.join();
+
+    ASSERT_FALSE(records.empty());
+    for (std::size_t index{3}; index < records.size(); ++index)
+    {
+        if (records[index].code == static_cast<std::uint8_t>(OpCode::Inc))
+        {
+            EXPECT_EQ(records[index].value, records[index - 2].value + 1);
+        }
+    }
+}
@@ -0,0 +1,112 @@
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include "assembler_interpreter/src/assembler_main.h"
+#include "assembler_interpreter/src/machine.h"
+#include "gtest/gtest.h"
+
+namespace
+{
+const std::string factorial_program{R"(
+mov n, 20
+mov f, 1
+call factorial
+msg '20! = ', f
+end
+factorial:
+    cmp n, 1
+    jle done
+    mul f, n
+    dec n
+    call factorial
+done:
+    ret
+)"};
+}  // namespace
+
+class WordSizeTest : public ::testing::TestWithParam<ExecutionEngine>
+{
+};
+
+TEST_P(WordSizeTest, WideMachinesComputeBeyondThirtyTwoBits)
+{
+    EXPECT_EQ(assembler_interpreter<std::int64_t>(factorial_program, GetParam()), "20! = 2432902008176640000");
+
+    Machine64 machine{};
+    machine.set_engine(GetParam());
+    machine.load_program(std::string_view{"mov a, 3000000000\nmov b, -4000000000\nadd a, b\ndiv a, 7\nend\n"});
+    machine.run_program();
+    EXPECT_EQ(machine.get_registers().at("a"), -142857142);
+}
+
+TEST_P(WordSizeTest, CountedLoopsReachWideValues)
+{
+    EXPECT_EQ(assembler_interpreter<std::int64_t>("mov a, 0\nmov b, 100000\nloop:\n    add a, 70000\n    dec b\n"
+                                                  "    jnz b, -2\nmsg 'a = ', a, ', b = ', b\nend\n",
+                                                  GetParam()),
+              "a = 7000000000, b = 0");
+    EXPECT_EQ(assembler_interpreter<std::int64_t>("mov a, 0\nmov b, 3\nloop:\n    add a, 5000000000\n    dec b\n"
+                                                  "    jnz b, -2\nmsg 'a = ', a\nend\n",
+                                                  GetParam()),
+              "a = 15000000000");
+}
+
+TEST_P(WordSizeTest, WideMachinesFoldOnlyWhatFitsTheirWords)
+{
+    const std::string_view program{"mov a, 100000\nmul a, a\nmsg 'a = ', a\nend\n"};
+    Machine64 wide{};
+    wide.set_engine(GetParam());
+    wide.set_constant_propagation(true);
+    wide.load_program(program);
+    EXPECT_FALSE(wide.compiled_program()->messages.front().segments().front().has_value);
+    wide.run_program();
+    EXPECT_EQ(wide.flush(), "a = 10000000000");
+
+    Machine narrow{};
+    narrow.set_engine(GetParam());
+    narrow.set_constant_propagation(true);
+    narrow.load_program(program);
+    EXPECT_TRUE(narrow.compiled_program()->messages.front().segments().front().has_value);
+}
+
+TEST_P(WordSizeTest, DivisionOfTheSmallestWordByMinusOneWraps)
+{
+    const std::string program{R"(
+mov b, -1
+div a, b
+mov c, 7
+div c, -1
+mov d, -7
+div d, 2
+msg a, ' ', c, ' ', d
+end
+)"};
+    EXPECT_EQ(assembler_interpreter<std::int32_t>("mov a, -2147483648\n" + program, GetParam()),
+              "-2147483648 -7 -3");
+    EXPECT_EQ(assembler_interpreter<std::int64_t>("mov a, -9223372036854775808\n" + program, GetParam()),
+              "-9223372036854775808 -7 -3");
+}
+
+INSTANTIATE_TEST_CASE_P(Engines,
+                        WordSizeTest,
+                        ::testing::Values(ExecutionEngine::Reference,
+                                          ExecutionEngine::Bytecode,
+                                          ExecutionEngine::Threaded,
+                                          ExecutionEngine::Jit));
+
+TEST(WordSizeTest, ValuesMustFitTheMachineWord)
+{
+    Machine narrow{};
+    EXPECT_THROW(narrow.load_program(std::string_view{"mov a, 3000000000\nend\n"}), std::out_of_range);
+
+    Machine64 wide{};
+    wide.load_program(std::string_view{"mov a, 3000000000\nend\n"});
+    EXPECT_THROW(narrow.load_program(wide.compiled_program()), std::out_of_range);
+    Machine64 fitting{};
+    fitting.load_program(std::string_view{"mov a, 300\nend\n"});
+    narrow.load_program(fitting.compiled_program());
+    narrow.run_program();
+    EXPECT_EQ(narrow.get_registers().at("a"), 300);
+    EXPECT_EQ(assembler<std::int64_t>({"mov a, 9000000000", "inc a"}).at("a"), 9000000001);
+}
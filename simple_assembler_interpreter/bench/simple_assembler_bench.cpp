@@ -0,0 +1,143 @@
+#include <benchmark/benchmark.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "assembler_interpreter/bench/counting_allocator.h"
+#include "simple_assembler_interpreter/src/machine.h"
+
+namespace
+{
+enum class Workload : int
+{
+    Complex1,
+    Complex3,
+    StraightLine,
+    Loop
+};
+
+const RawProgram complex1_program{"mov a 1",  "mov b 1",  "mov c 0", "mov d 26", "jnz c 2",  "jnz 1 5",
+                                  "mov c 7",  "inc d",    "dec c",   "jnz c -2", "mov c a",  "inc a",
+                                  "dec b",    "jnz b -2", "mov b c", "dec d",    "jnz d -6", "mov c 18",
+                                  "mov d 11", "inc a",    "dec d",   "jnz d -2", "dec c",    "jnz c -5"};
+
+const RawProgram complex3_program{"mov c 12", "mov b 0",  "mov a 200", "dec a",   "inc b",  "jnz a -2",
+                                  "dec c",    "mov a b",  "jnz c -5",  "jnz 0 1", "mov c a"};
+
+RawProgram straight_line_program(std::int64_t length)
+{
+    static const char* const lines[]{"mov a 7", "inc b", "mov c b", "dec a", "inc c", "mov b a"};
+    RawProgram program{};
+    for (std::int64_t line{0}; line < length; ++line)
+    {
+        program.push_back(lines[line % 6]);
+    }
+    return program;
+}
+
+RawProgram loop_program(std::int64_t iterations)
+{
+    return {"mov a " + std::to_string(iterations), "mov b 10", "inc c", "dec b", "jnz b -2", "dec a", "jnz a -5"};
+}
+
+RawProgram make_program(benchmark::State const& state)
+{
+    const auto size{state.range(1)};
+    switch (static_cast<Workload>(state.range(0)))
+    {
+        case Workload::Complex1:
+            return complex1_program;
+        case Workload::Complex3:
+            return complex3_program;
+        case Workload::StraightLine:
+            return straight_line_program(size);
+        case Workload::Loop:
+            return loop_program(size);
+    }
+    return {};
+}
+
+// Counted without loop collapsing, so the rate reflects the instructions the program asks for.
+std::uint64_t executed_instructions(RawProgram const& program)
+{
+    Machine machine{};
+    machine.set_loop_collapsing(false);
+    machine.load_program(program);
+    machine.run_program();
+    return machine.executed_instructions();
+}
+
+void set_instruction_counters(benchmark::State& state, std::uint64_t instructions_per_iteration)
+{
+    const auto instructions{static_cast<double>(instructions_per_iteration) * state.iterations()};
+    state.counters["instructions/s"] = benchmark::Counter(instructions, benchmark::Counter::kIsRate);
+    state.counters["time/instruction"] =
+        benchmark::Counter(instructions, benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+}
+
+void BM_ParseProgram(benchmark::State& state)
+{
+    const auto program{make_program(state)};
+    const auto allocations_before{allocation_count.load()};
+    for (auto _ : state)
+    {
+        Machine machine{};
+        machine.parse_program(program);
+        benchmark::DoNotOptimize(&machine);
+    }
+    state.counters["allocations/load"] = benchmark::Counter(
+        static_cast<double>(allocation_count.load() - allocations_before), benchmark::Counter::kAvgIterations);
+    set_instruction_counters(state, program.size());
+}
+
+void BM_PreRun(benchmark::State& state)
+{
+    const auto program{make_program(state)};
+    for (auto _ : state)
+    {
+        state.PauseTiming();
+        Machine machine{};
+        machine.parse_program(program);
+        state.ResumeTiming();
+        machine.pre_run();
+        benchmark::DoNotOptimize(&machine);
+    }
+    set_instruction_counters(state, program.size());
+}
+
+void BM_RunProgram(benchmark::State& state)
+{
+    const auto program{make_program(state)};
+    for (auto _ : state)
+    {
+        state.PauseTiming();
+        Machine machine{};
+        machine.load_program(program);
+        state.ResumeTiming();
+        machine.run_program();
+        benchmark::DoNotOptimize(&machine);
+    }
+    set_instruction_counters(state, executed_instructions(program));
+}
+
+void load_arguments(benchmark::internal::Benchmark* benchmark)
+{
+    benchmark->ArgNames({"workload", "size"});
+    benchmark->Args({static_cast<int>(Workload::Complex1), 0});
+    benchmark->Args({static_cast<int>(Workload::Complex3), 0});
+    benchmark->Args({static_cast<int>(Workload::StraightLine), 1000});
+    benchmark->Args({static_cast<int>(Workload::StraightLine), 100000});
+}
+
+void run_arguments(benchmark::internal::Benchmark* benchmark)
+{
+    benchmark->ArgNames({"workload", "size"});
+    benchmark->Args({static_cast<int>(Workload::Complex1), 0});
+    benchmark->Args({static_cast<int>(Workload::Complex3), 0});
+    benchmark->Args({static_cast<int>(Workload::StraightLine), 10000});
+    benchmark->Args({static_cast<int>(Workload::Loop), 100000});
+}
+}  // namespace
+
+BENCHMARK(BM_ParseProgram)->Apply(load_arguments);
+BENCHMARK(BM_PreRun)->Apply(load_arguments);
+BENCHMARK(BM_RunProgram)->Apply(run_arguments);
@@ -0,0 +1,188 @@
+#ifndef MACHINE_H
+#define MACHINE_H
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+#include "simple_assembler_interpreter/src/assembler_main.h"
+
+using RawProgram = std::vector<std::string>;
+using Registers = std::unordered_map<std::string, int>;
+using Slot = std::uint32_t;
+using Tokens = std::vector<std::string_view>;
+class Instruction;
+// Instructions live in an InstructionArena, so owning them only means destroying them.
+struct InstructionDeleter
+{
+    void operator()(Instruction* instruction) const;
+};
+using Instruction_ptr = std::unique_ptr<Instruction, InstructionDeleter>;
+using Program = std::vector<Instruction_ptr>;
+using ProgramPtr = Program::iterator;
+
+inline bool is_register(std::string_view val)
+{
+    const auto result{std::find_if(val.begin(), val.end(), [](auto const& c) { return std::isalpha(c); })};
+    return result != val.end();
+}
+
+class ValueResolver
+{
+  public:
+    ValueResolver(std::vector<int>* slots) : slots_{slots} {}
+    int get_value_of(Slot slot) const
+    {
+        return (*slots_)[slot];
+    };
+
+  private:
+    std::vector<int>* slots_{nullptr};
+};
+
+// Register names and immediates are interned at load time into slots of one dense value array.
+// Named slots are registers, unnamed slots hold immediates.
+class SlotTable
+{
+  public:
+    Slot register_slot(std::string const& name);
+    Slot operand_slot(std::string const& operand);
+    std::vector<std::string> const& names() const;
+    std::vector<int> const& initial_values() const;
+
+  private:
+    Slot add_slot(std::string name, int initial_value);
+
+    std::vector<std::string> names_{};
+    std::vector<int> initial_values_{};
+    std::unordered_map<std::string, Slot> register_slots_{};
+    std::unordered_map<int, Slot> constant_slots_{};
+};
+
+// Monotonic storage for the instructions of a loaded program and for their operand strings, each stored once.
+class InstructionArena
+{
+  public:
+    template <typename T, typename... Arguments>
+    Instruction_ptr create(Arguments&&... arguments)
+    {
+        auto* const storage{resource_.allocate(sizeof(T), alignof(T))};
+        return Instruction_ptr{new (storage) T(std::forward<Arguments>(arguments)...)};
+    }
+    std::string_view intern(std::string_view text);
+
+  private:
+    std::pmr::monotonic_buffer_resource resource_{};
+    std::pmr::unordered_set<std::string_view> strings_{&resource_};
+};
+
+class InstructionFactory
+{
+  public:
+    InstructionFactory(std::vector<int>& slots, InstructionArena& arena);
+    Instruction_ptr create_instruction(std::string_view name, Tokens const& arguments);
+
+    template <typename T>
+    Instruction_ptr make_instruction(Tokens const& tokens)
+    {
+        auto new_instruction{arena_->create<T>(tokens, *arena_)};
+        new_instruction->set_resolver(&value_resolver_);
+        return new_instruction;
+    }
+
+  private:
+    InstructionArena* arena_{nullptr};
+    ValueResolver value_resolver_;
+};
+
+class Machine
+{
+  public:
+    void load_program(RawProgram const& prog);
+    void parse_program(RawProgram const& prog);
+    void pre_run();
+    void reset();
+    void run_program();
+    void set_loop_collapsing(bool enabled);
+    void set_register(std::string const& name, int value);
+    std::uint64_t executed_instructions() const;
+    int& get_register(Slot slot);
+    Registers get_registers() const;
+    Slot operand_slot(std::string_view operand);
+    Slot register_slot(std::string_view name);
+    void advance_ip(std::ptrdiff_t diff);
+    void skip_instruction();
+
+  private:
+    void collapse_counting_loops();
+    void fuse_superinstructions();
+    void reset_slots();
+    static void split_tokens(std::string_view command, Tokens& tokens);
+    Instruction& get_current_instruction() const;
+    SlotTable slot_table_{};
+    std::vector<int> slots_{};
+    std::vector<std::uint8_t> touched_slots_{};
+    std::vector<std::pair<Slot, int>> seeded_registers_{};
+    InstructionArena arena_{};
+    ProgramPtr ip_{program_.begin()};
+    Program program_{};
+    InstructionFactory instruction_factory_{slots_, arena_};
+    std::uint64_t executed_instructions_{0};
+    bool collapse_loops_{true};
+};
+
+class Instruction
+{
+  public:
+    virtual ~Instruction() = default;
+    void set_resolver(ValueResolver* resolver)
+    {
+        value_resolver_ = resolver;
+    }
+    virtual void pre_run(Machine& machine) {}
+    virtual void operate_on(Machine& machine) = 0;
+
+  protected:
+    ValueResolver* value_resolver_{nullptr};
+};
+
+class UnaryInstruction : public Instruction
+{
+  public:
+    UnaryInstruction(Tokens const& tokens, InstructionArena& arena)
+        : Instruction(), register_{arena.intern(tokens.at(0))}
+    {
+    }
+    ~UnaryInstruction() = default;
+    void pre_run(Machine& machine) override;
+
+  protected:
+    std::string_view register_{};
+    Slot register_slot_{0};
+};
+
+class BinaryInstruction : public Instruction
+{
+  public:
+    BinaryInstruction(Tokens const& tokens, InstructionArena& arena)
+        : Instruction(), register_{arena.intern(tokens.at(0))}, value_{arena.intern(tokens.at(1))}
+    {
+    }
+    ~BinaryInstruction() = default;
+    void pre_run(Machine& machine) override;
+
+  protected:
+    std::string_view register_{};
+    std::string_view value_{};
+    Slot register_slot_{0};
+    Slot value_slot_{0};
+};
+
+#endif /* MACHINE_H */
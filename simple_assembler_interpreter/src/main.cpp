@@ -1,179 +1,115 @@
 #include <algorithm>
-#include <cctype>
-#include <functional>
 #include <iterator>
-#include <memory>
-#include <sstream>
-#include <string>
-#include <unordered_map>
-#include <vector>
+#include <limits>
+#include <stdexcept>
+#include "simple_assembler_interpreter/src/machine.h"
 
-using RawProgram = std::vector<std::string>;
-using Registers = std::unordered_map<std::string, int>;
-class Instruction;
-using Instruction_ptr = std::unique_ptr<Instruction>;
-using Program = std::vector<Instruction_ptr>;
-using ProgramPtr = Program::iterator;
-
-bool is_register(std::string const& val)
-{
-    const auto result{std::find_if(val.begin(), val.end(), [](auto const& c) { return std::isalpha(c); })};
-    return result != val.end();
-}
-
-class ValueResolver
+class Mov : public BinaryInstruction
 {
   public:
-    ValueResolver(Registers* registers) : registers_{registers} {}
-    int get_value_of(std::string const& in)
-    {
-        if (is_register(in))
-        {
-            return registers_->at(in);
-        }
-        else
-        {
-            const auto value_as_int{std::stoi(in)};
-            return value_as_int;
-        }
-    };
-
-  private:
-    Registers* registers_{nullptr};
+    using BinaryInstruction::BinaryInstruction;
+    void operate_on(Machine& machine) override;
 };
 
-class InstructionFactory
+class Inc : public UnaryInstruction
 {
   public:
-    InstructionFactory(Registers&);
-    Instruction_ptr create_instruction(std::string const& name, std::vector<std::string> const& arguments);
+    using UnaryInstruction::UnaryInstruction;
+    void operate_on(Machine& machine) override;
 
   private:
-    template <typename T>
-    std::unique_ptr<T> make_instruction(std::vector<std::string> const& tokens)
-    {
-        auto new_instruction{std::make_unique<T>(tokens)};
-        new_instruction->set_resolver(&value_resolver_);
-        return std::move(new_instruction);
-    }
-
-    std::unordered_map<std::string, std::function<Instruction_ptr(std::vector<std::string>)>> instruction_map_{};
-    Registers& registers_;
-    ValueResolver value_resolver_{&registers_};
+    friend class CountedLoop;
 };
 
-class Machine
+class Dec : public UnaryInstruction
 {
   public:
-    void load_program(RawProgram const& prog);
-    void run_program();
-    int const& get_register(std::string const&) const;
-    int& get_register(std::string const&);
-    Registers const& get_registers() const;
-    void advance_ip(std::ptrdiff_t diff);
+    using UnaryInstruction::UnaryInstruction;
+    void operate_on(Machine& machine) override;
 
   private:
-    std::vector<std::string> split_tokens(std::string const& command);
-    Instruction& get_current_instruction() const;
-    Registers registers_{};
-    ProgramPtr ip_{program_.begin()};
-    Program program_{};
-    InstructionFactory instruction_factory_{registers_};
-};
-
-class Instruction
-{
-  public:
-    ~Instruction() = default;
-    void set_resolver(ValueResolver* resolver)
-    {
-        value_resolver_ = resolver;
-    }
-    virtual void operate_on(Machine& machine) = 0;
-
-  protected:
-    std::string name_{};
-    ValueResolver* value_resolver_{nullptr};
+    friend class CountedLoop;
+    friend class DecJnz;
 };
 
-class UnaryInstruction : public Instruction
+class Jnz : public BinaryInstruction
 {
   public:
-    UnaryInstruction(std::vector<std::string> const& tokens) : Instruction(), register_{tokens.at(0)} {}
-    ~UnaryInstruction() = default;
+    using BinaryInstruction::BinaryInstruction;
+    void operate_on(Machine& machine) override;
 
-  protected:
-    std::string register_{};
+  private:
+    friend class CountedLoop;
+    friend class DecJnz;
+    int calculate_jump_distance();
 };
 
-class BinaryInstruction : public Instruction
+// dec x followed by jnz x y, run as a single instruction. The jnz stays in the program behind it, so jumps
+// landing on it keep working, and is skipped when falling through.
+class DecJnz : public Instruction
 {
   public:
-    BinaryInstruction(std::vector<std::string> const& tokens)
-        : Instruction(), register_{tokens.at(0)}, value_{tokens.at(1)}
-    {
-    }
-    ~BinaryInstruction() = default;
+    DecJnz(Dec const& dec, Jnz const& jnz);
+    static bool can_fuse(Dec const& dec, Jnz const& jnz);
+    void operate_on(Machine& machine) override;
 
-  protected:
-    std::string register_{};
-    std::string value_{};
+  private:
+    Slot counter_slot_{0};
+    Slot distance_slot_{0};
 };
 
-class Mov : public BinaryInstruction
+// jnz closing a loop whose body only increments and decrements registers. When the loop goes on, all its
+// remaining iterations are applied at once, unless the counter would overflow before reaching zero.
+class CountedLoop : public Instruction
 {
   public:
-    using BinaryInstruction::BinaryInstruction;
+    CountedLoop(Slot counter_slot, std::ptrdiff_t distance, std::vector<std::pair<Slot, int>> steps);
+    static Instruction_ptr recognize(Program const& program,
+                                     std::size_t index,
+                                     SlotTable const& slot_table,
+                                     InstructionArena& arena);
     void operate_on(Machine& machine) override;
-};
 
-class Inc : public UnaryInstruction
-{
-  public:
-    using UnaryInstruction::UnaryInstruction;
-    void operate_on(Machine& machine) override;
+  private:
+    Slot counter_slot_{0};
+    std::ptrdiff_t distance_{0};
+    std::vector<std::pair<Slot, int>> steps_{};
 };
 
-class Dec : public UnaryInstruction
+void UnaryInstruction::pre_run(Machine& machine)
 {
-  public:
-    using UnaryInstruction::UnaryInstruction;
-    void operate_on(Machine& machine) override;
-};
+    register_slot_ = machine.register_slot(register_);
+}
 
-class Jnz : public BinaryInstruction
+void BinaryInstruction::pre_run(Machine& machine)
 {
-  public:
-    using BinaryInstruction::BinaryInstruction;
-    void operate_on(Machine& machine) override;
-
-  private:
-    int calculate_jump_distance();
-};
+    register_slot_ = machine.operand_slot(register_);
+    value_slot_ = machine.operand_slot(value_);
+}
 
 void Mov::operate_on(Machine& machine)
 {
-    machine.get_register(register_) = value_resolver_->get_value_of(value_);
+    machine.get_register(register_slot_) = value_resolver_->get_value_of(value_slot_);
 }
 
 void Inc::operate_on(Machine& machine)
 {
-    ++(machine.get_register(register_));
+    ++(machine.get_register(register_slot_));
 }
 
 void Dec::operate_on(Machine& machine)
 {
-    --(machine.get_register(register_));
+    --(machine.get_register(register_slot_));
 }
 
 int Jnz::calculate_jump_distance()
 {
-    return value_resolver_->get_value_of(value_);
+    return value_resolver_->get_value_of(value_slot_);
 }
 
 void Jnz::operate_on(Machine& machine)
 {
-    const int jump_condition{value_resolver_->get_value_of(register_)};
+    const int jump_condition{value_resolver_->get_value_of(register_slot_)};
     if (jump_condition != 0)
     {
         const std::ptrdiff_t jump_distance{calculate_jump_distance()};
@@ -181,18 +117,180 @@ void Jnz::operate_on(Machine& machine)
     }
 }
 
-InstructionFactory::InstructionFactory(Registers& registers) : registers_{registers}
+Slot SlotTable::register_slot(std::string const& name)
+{
+    const auto found{register_slots_.find(name)};
+    if (found != register_slots_.end())
+    {
+        return found->second;
+    }
+    const auto slot{add_slot(name, 0)};
+    register_slots_.emplace(name, slot);
+    return slot;
+}
+
+Slot SlotTable::operand_slot(std::string const& operand)
+{
+    if (is_register(operand))
+    {
+        return register_slot(operand);
+    }
+    const int value{std::stoi(operand)};
+    const auto found{constant_slots_.find(value)};
+    if (found != constant_slots_.end())
+    {
+        return found->second;
+    }
+    const auto slot{add_slot({}, value)};
+    constant_slots_.emplace(value, slot);
+    return slot;
+}
+
+std::vector<std::string> const& SlotTable::names() const
+{
+    return names_;
+}
+
+std::vector<int> const& SlotTable::initial_values() const
+{
+    return initial_values_;
+}
+
+Slot SlotTable::add_slot(std::string name, int initial_value)
+{
+    names_.push_back(std::move(name));
+    initial_values_.push_back(initial_value);
+    return static_cast<Slot>(names_.size() - 1);
+}
+
+void InstructionDeleter::operator()(Instruction* instruction) const
+{
+    instruction->~Instruction();
+}
+
+std::string_view InstructionArena::intern(std::string_view text)
+{
+    const auto interned{strings_.find(text)};
+    if (interned != strings_.end())
+    {
+        return *interned;
+    }
+    auto* const characters{static_cast<char*>(resource_.allocate(text.size(), alignof(char)))};
+    std::copy(text.begin(), text.end(), characters);
+    return *strings_.emplace(characters, text.size()).first;
+}
+
+InstructionFactory::InstructionFactory(std::vector<int>& slots, InstructionArena& arena)
+    : arena_{&arena}, value_resolver_{&slots}
+{
+}
+
+Instruction_ptr InstructionFactory::create_instruction(std::string_view name, Tokens const& arguments)
+{
+    using Maker = Instruction_ptr (InstructionFactory::*)(Tokens const&);
+    static const std::unordered_map<std::string_view, Maker> instruction_map{
+        {"mov", &InstructionFactory::make_instruction<Mov>},
+        {"jnz", &InstructionFactory::make_instruction<Jnz>},
+        {"inc", &InstructionFactory::make_instruction<Inc>},
+        {"dec", &InstructionFactory::make_instruction<Dec>}};
+    return (this->*instruction_map.at(name))(arguments);
+}
+
+DecJnz::DecJnz(Dec const& dec, Jnz const& jnz)
+    : Instruction(), counter_slot_{dec.register_slot_}, distance_slot_{jnz.value_slot_}
+{
+    set_resolver(jnz.value_resolver_);
+}
+
+bool DecJnz::can_fuse(Dec const& dec, Jnz const& jnz)
+{
+    return jnz.register_slot_ == dec.register_slot_;
+}
+
+void DecJnz::operate_on(Machine& machine)
+{
+    const int counter{--(machine.get_register(counter_slot_))};
+    machine.skip_instruction();
+    if (counter != 0)
+    {
+        machine.advance_ip(value_resolver_->get_value_of(distance_slot_));
+    }
+}
+
+CountedLoop::CountedLoop(Slot counter_slot, std::ptrdiff_t distance, std::vector<std::pair<Slot, int>> steps)
+    : Instruction(), counter_slot_{counter_slot}, distance_{distance}, steps_{std::move(steps)}
+{
+}
+
+Instruction_ptr CountedLoop::recognize(Program const& program,
+                                       std::size_t index,
+                                       SlotTable const& slot_table,
+                                       InstructionArena& arena)
 {
-    instruction_map_.emplace("mov", [this](auto const& tokens) { return make_instruction<Mov>(tokens); });
-    instruction_map_.emplace("jnz", [this](auto const& tokens) { return make_instruction<Jnz>(tokens); });
-    instruction_map_.emplace("inc", [this](auto const& tokens) { return make_instruction<Inc>(tokens); });
-    instruction_map_.emplace("dec", [this](auto const& tokens) { return make_instruction<Dec>(tokens); });
+    auto const* jnz{dynamic_cast<Jnz const*>(program[index].get())};
+    if (!jnz || !slot_table.names()[jnz->value_slot_].empty())
+    {
+        return nullptr;
+    }
+    const std::ptrdiff_t distance{slot_table.initial_values()[jnz->value_slot_]};
+    if (distance >= 0 || static_cast<std::ptrdiff_t>(index) + distance < 1)
+    {
+        return nullptr;
+    }
+
+    std::vector<std::pair<Slot, int>> steps{};
+    for (auto body{index + distance}; body < index; ++body)
+    {
+        auto const* inc{dynamic_cast<Inc const*>(program[body].get())};
+        auto const* dec{dynamic_cast<Dec const*>(program[body].get())};
+        if (!inc && !dec)
+        {
+            return nullptr;
+        }
+        const auto slot{inc ? inc->register_slot_ : dec->register_slot_};
+        auto step{std::find_if(steps.begin(), steps.end(), [slot](auto const& step) { return step.first == slot; })};
+        if (step == steps.end())
+        {
+            step = steps.insert(steps.end(), {slot, 0});
+        }
+        step->second += inc ? 1 : -1;
+    }
+    const auto counter_slot{jnz->register_slot_};
+    const auto is_counter{[counter_slot](auto const& step) { return step.first == counter_slot; }};
+    if (std::none_of(steps.begin(), steps.end(), is_counter))
+    {
+        return nullptr;
+    }
+    return arena.create<CountedLoop>(counter_slot, distance, std::move(steps));
 }
 
-Instruction_ptr InstructionFactory::create_instruction(std::string const& name,
-                                                       std::vector<std::string> const& arguments)
+void CountedLoop::operate_on(Machine& machine)
 {
-    return instruction_map_.at(name)(arguments);
+    const std::int64_t counter{machine.get_register(counter_slot_)};
+    if (counter == 0)
+    {
+        return;
+    }
+    const auto counter_step{
+        std::find_if(steps_.begin(), steps_.end(), [this](auto const& step) { return step.first == counter_slot_; })
+            ->second};
+    const bool reaches_zero{counter_step != 0 && counter % counter_step == 0 && -counter / counter_step > 0};
+    const auto trips{reaches_zero ? -counter / counter_step : 0};
+    const auto final_value{
+        [&machine, trips](auto const& step) { return machine.get_register(step.first) + trips * step.second; }};
+    const bool fits{std::all_of(steps_.begin(), steps_.end(), [&final_value](auto const& step) {
+        const auto value{final_value(step)};
+        return value >= std::numeric_limits<int>::min() && value <= std::numeric_limits<int>::max();
+    })};
+    if (!reaches_zero || !fits)
+    {
+        machine.advance_ip(distance_);
+        return;
+    }
+    for (auto const& step : steps_)
+    {
+        machine.get_register(step.first) = static_cast<int>(final_value(step));
+    }
 }
 
 Instruction& Machine::get_current_instruction() const
@@ -217,45 +315,163 @@ void Machine::advance_ip(std::ptrdiff_t diff)
     }
 }
 
+void Machine::skip_instruction()
+{
+    std::advance(ip_, 1);
+    ++executed_instructions_;
+}
+
 void Machine::load_program(RawProgram const& prog)
 {
+    parse_program(prog);
+    pre_run();
+    if (collapse_loops_)
+    {
+        collapse_counting_loops();
+    }
+    fuse_superinstructions();
+}
+
+void Machine::set_loop_collapsing(bool enabled)
+{
+    collapse_loops_ = enabled;
+}
+
+void Machine::collapse_counting_loops()
+{
+    for (std::size_t index{0}; index < program_.size(); ++index)
+    {
+        auto loop{CountedLoop::recognize(program_, index, slot_table_, arena_)};
+        if (loop)
+        {
+            program_[index] = std::move(loop);
+        }
+    }
+}
+
+void Machine::fuse_superinstructions()
+{
+    for (std::size_t index{0}; index + 1 < program_.size(); ++index)
+    {
+        auto const* dec{dynamic_cast<Dec const*>(program_[index].get())};
+        auto const* jnz{dynamic_cast<Jnz const*>(program_[index + 1].get())};
+        if (dec && jnz && DecJnz::can_fuse(*dec, *jnz))
+        {
+            program_[index] = arena_.create<DecJnz>(*dec, *jnz);
+        }
+    }
+}
+
+void Machine::parse_program(RawProgram const& prog)
+{
+    program_.reserve(program_.size() + prog.size());
+    Tokens tokens{};
+    Tokens arguments{};
     for (auto const& instruction : prog)
     {
-        auto tokens{split_tokens(instruction)};
-        program_.push_back(
-            instruction_factory_.create_instruction(tokens.front(), {std::next(tokens.begin(), 1), tokens.end()}));
+        split_tokens(instruction, tokens);
+        arguments.assign(std::next(tokens.begin(), 1), tokens.end());
+        program_.push_back(instruction_factory_.create_instruction(tokens.front(), arguments));
     }
-    ip_ = program_.begin();
+}
+
+void Machine::pre_run()
+{
+    for (ip_ = program_.begin(); ip_ != program_.end(); std::advance(ip_, 1))
+    {
+        get_current_instruction().pre_run(*this);
+    }
+}
+
+void Machine::reset()
+{
+    seeded_registers_.clear();
+}
+
+void Machine::reset_slots()
+{
+    slots_ = slot_table_.initial_values();
+    touched_slots_.assign(slots_.size(), 0);
+    for (auto const& seed : seeded_registers_)
+    {
+        slots_[seed.first] = seed.second;
+        touched_slots_[seed.first] = 1;
+    }
+}
+
+void Machine::set_register(std::string const& name, int value)
+{
+    auto const& names{slot_table_.names()};
+    const auto slot{name.empty() ? names.end() : std::find(names.begin(), names.end(), name)};
+    if (slot == names.end())
+    {
+        throw std::out_of_range{"Unknown register " + name};
+    }
+    seeded_registers_.emplace_back(static_cast<Slot>(slot - names.begin()), value);
 }
 
 void Machine::run_program()
 {
+    reset_slots();
+    executed_instructions_ = 0;
+    ip_ = program_.begin();
     while (ip_ != program_.end())
     {
         get_current_instruction().operate_on(*this);
         std::advance(ip_, 1);
+        ++executed_instructions_;
     }
 }
 
-std::vector<std::string> Machine::split_tokens(std::string const& command)
+std::uint64_t Machine::executed_instructions() const
 {
-    std::istringstream splitter(command);
-    return std::vector<std::string>((std::istream_iterator<std::string>(splitter)),
-                                    std::istream_iterator<std::string>());
+    return executed_instructions_;
 }
-int const& Machine::get_register(std::string const& register_name) const
+
+void Machine::split_tokens(std::string_view command, Tokens& tokens)
 {
-    return registers_.at(register_name);
+    const auto is_space{[](char c) { return std::isspace(static_cast<unsigned char>(c)) != 0; }};
+    tokens.clear();
+    auto position{command.begin()};
+    while (true)
+    {
+        const auto begin{std::find_if_not(position, command.end(), is_space)};
+        if (begin == command.end())
+        {
+            return;
+        }
+        position = std::find_if(begin, command.end(), is_space);
+        tokens.emplace_back(&*begin, static_cast<std::size_t>(position - begin));
+    }
+}
+int& Machine::get_register(Slot slot)
+{
+    touched_slots_[slot] = 1;
+    return slots_[slot];
 }
 
-int& Machine::get_register(std::string const& register_name)
+Slot Machine::operand_slot(std::string_view operand)
 {
-    return registers_[register_name];
+    return slot_table_.operand_slot(std::string{operand});
 }
 
-Registers const& Machine::get_registers() const
+Slot Machine::register_slot(std::string_view name)
 {
-    return registers_;
+    return slot_table_.register_slot(std::string{name});
+}
+
+Registers Machine::get_registers() const
+{
+    Registers registers{};
+    auto const& names{slot_table_.names()};
+    for (Slot slot{0}; slot < touched_slots_.size(); ++slot)
+    {
+        if (touched_slots_[slot])
+        {
+            registers.emplace(names[slot], slots_[slot]);
+        }
+    }
+    return registers;
 }
 
 // static int& getReg(Registers& regs, std::string name)
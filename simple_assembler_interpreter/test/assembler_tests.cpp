@@ -4,6 +4,7 @@
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include "simple_assembler_interpreter/src/assembler_main.h"
+#include "simple_assembler_interpreter/src/machine.h"
 
 using ::testing::ContainerEq;
 
@@ -88,3 +89,40 @@ TEST(SimpleAssembler_1, Complex3Fake)
                                      "mov c a"};
     assembler(program);
 }
+
+TEST(SimpleAssembler_1, JumpIntoFusedDecJnz)
+{
+    std::vector<std::string> program{"mov a 2", "mov c 1", "jnz c 2", "dec a", "jnz a -1", "inc b"};
+    std::unordered_map<std::string, int> out{{"a", 0}, {"b", 1}, {"c", 1}};
+    EXPECT_THAT(assembler(program), ::testing::ContainerEq(out));
+
+    // Collapsed, the loop would never reach the fused dec and jnz.
+    Machine machine{};
+    machine.set_loop_collapsing(false);
+    machine.load_program(program);
+    machine.run_program();
+    EXPECT_THAT(machine.get_registers(), ::testing::ContainerEq(out));
+}
+
+TEST(SimpleAssembler_1, CountingLoopIsCollapsed)
+{
+    std::vector<std::string> program{"mov a 1000000000", "inc b", "inc b", "dec c", "dec a", "jnz a -4"};
+    std::unordered_map<std::string, int> out{{"a", 0}, {"b", 2000000000}, {"c", -1000000000}};
+    EXPECT_THAT(assembler(program), ::testing::ContainerEq(out));
+}
+
+TEST(SimpleAssembler_1, MachineRunsAgainWithSeededRegisters)
+{
+    Machine machine{};
+    machine.load_program({"mov b 0", "inc b", "dec a", "jnz a -2"});
+    machine.set_register("a", 3);
+    machine.run_program();
+    std::unordered_map<std::string, int> out{{"a", 0}, {"b", 3}};
+    EXPECT_THAT(machine.get_registers(), ::testing::ContainerEq(out));
+
+    machine.reset();
+    machine.set_register("a", 7);
+    machine.run_program();
+    out = {{"a", 0}, {"b", 7}};
+    EXPECT_THAT(machine.get_registers(), ::testing::ContainerEq(out));
+}